@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Search a file of positions, one to a line, for analysis jobs. The
+ * main thread reads positions into a ring of slots and writes out the
+ * results in order as they come in; each worker takes the next
+ * position not yet taken and searches it alone, with its own hash
+ * table. Reading stops when the ring is full of positions whose
+ * results haven't been written, so memory doesn't grow with the file.
+ *
+ * The hash table is cleared before each position, so the results are
+ * the same however many threads there are.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+#define SLOTSPERTHREAD 64
+#define LINELEN 128		/* longest line read, plus NUL */
+#define RESULTLEN (MAXPLY * MOVELEN + 96)
+
+struct slot {
+  char		 line[LINELEN];
+  char		 result[RESULTLEN];
+  int		 toolong;
+  int		 done;
+};
+
+struct ring {
+  const struct batch *b;
+  pthread_mutex_t lock;
+  pthread_cond_t work;		/* signalled as positions are read */
+  pthread_cond_t done;		/* and as they're searched */
+  struct slot	*slot;
+  unsigned long	 nslots;
+  unsigned long	 read;		/* positions read */
+  unsigned long	 taken;		/* of them, taken by a worker */
+  unsigned long	 written;	/* and whose results are written */
+  int		 eof;
+};
+
+struct worker {
+  pthread_t	 tid;
+  struct ring	*ring;
+  struct search	*s;
+  struct tt	 tt;
+  uint64_t	 nodes;
+};
+
+static int	 readline(FILE *, char *);
+static void	 evaluate1(struct worker *, struct slot *);
+static void	*work(void *);
+
+/*
+ * Read a line into buf, dropping its newline. Returns 1, 0 at the end
+ * of the file, or -1 if the line was too long, having skipped it.
+ */
+static int
+readline(FILE *fp, char *buf)
+{
+  size_t len;
+  int c;
+
+  if (!fgets(buf, LINELEN, fp)) {
+    return 0;
+  }
+  len = strlen(buf);
+  if (len > 0 && buf[len - 1] == '\n') {
+    buf[len - 1] = '\0';
+    return 1;
+  } else if (len < LINELEN - 1) {
+    /* The last line, without a newline */
+    return 1;
+  }
+  while ((c = getc(fp)) != '\n' && c != EOF) {
+    continue;
+  }
+  return -1;
+}
+
+/*
+ * Search the position in sl, leaving the result alongside it
+ */
+static void
+evaluate1(struct worker *w, struct slot *sl)
+{
+  const struct batch *b = w->ring->b;
+  char buf[MAXPLY * MOVELEN], mbuf[MOVELEN], score[SCORELEN];
+  game g;
+  move_t m;
+
+  if (sl->toolong) {
+    snprintf(sl->result, RESULTLEN, "error line too long");
+    return;
+  } else if (parsepos(&g, sl->line) == -1) {
+    snprintf(sl->result, RESULTLEN, "error invalid position");
+    return;
+  }
+  ttclear(&w->tt);
+  initsearch(w->s, &g);
+  w->s->maxdepth = b->maxdepth;
+  w->s->maxnodes = b->maxnodes;
+  w->s->maxtime = b->maxtime;
+  w->s->nthreads = 1;
+  w->s->tt = &w->tt;
+  w->s->egdb = g.type == b->egtype ? b->egdb : NULL;
+  if ((m = think(w->s)) == NOMOVE) {
+    /* The player to move has lost */
+    snprintf(sl->result, RESULTLEN, "score loss 0 depth 0 nodes 0 "
+	     "bestmove none pv");
+    return;
+  }
+  w->nodes += w->s->nodes;
+  snprintf(sl->result, RESULTLEN, "score %s depth %d nodes %llu "
+	   "bestmove %s pv %s", fmtscore(w->s->score, score), w->s->depth,
+	   (unsigned long long)w->s->nodes, fmtmove(&g, m, mbuf),
+	   fmtpv(w->s, buf, sizeof(buf)));
+}
+
+/*
+ * Search positions until they run out
+ */
+static void *
+work(void *arg)
+{
+  struct worker *w = arg;
+  struct ring *r = w->ring;
+  struct slot *sl;
+
+  pthread_mutex_lock(&r->lock);
+  for (;;) {
+    while (r->taken == r->read && !r->eof) {
+      pthread_cond_wait(&r->work, &r->lock);
+    }
+    if (r->taken == r->read) {
+      break;
+    }
+    sl = &r->slot[r->taken++ % r->nslots];
+    pthread_mutex_unlock(&r->lock);
+    evaluate1(w, sl);
+    pthread_mutex_lock(&r->lock);
+    sl->done = 1;
+    pthread_cond_signal(&r->done);
+  }
+  pthread_mutex_unlock(&r->lock);
+  return NULL;
+}
+
+/*
+ * Search every position in b->in, writing a line for each to b->out:
+ * the position, then its score, the depth reached, the nodes searched,
+ * the best move and the expected line of play. Positions that can't be
+ * read get an error instead. A report follows on standard error.
+ */
+void
+runbatch(const struct batch *b)
+{
+  struct ring r;
+  struct worker *w;
+  struct slot *sl;
+  uint64_t nodes = 0;
+  double start, secs;
+  int i, c, nthreads = b->nthreads < 1 ? 1 : b->nthreads;
+
+  r.b = b;
+  pthread_mutex_init(&r.lock, NULL);
+  pthread_cond_init(&r.work, NULL);
+  pthread_cond_init(&r.done, NULL);
+  r.nslots = (unsigned long)nthreads * SLOTSPERTHREAD;
+  r.read = r.taken = r.written = 0;
+  r.eof = 0;
+  if (!(r.slot = calloc(r.nslots, sizeof(*r.slot))) ||
+      !(w = calloc(nthreads, sizeof(*w)))) {
+    err(1, "Unable to allocate the positions");
+  }
+  start = walltime();
+  for (i = 0; i < nthreads; i++) {
+    w[i].ring = &r;
+    if (!(w[i].s = malloc(sizeof(*w[i].s)))) {
+      err(1, "Unable to allocate the searches");
+    } else if (ttinit(&w[i].tt, b->hashmb) == -1) {
+      err(1, "Unable to allocate the hash tables");
+    } else if (pthread_create(&w[i].tid, NULL, work, &w[i]) != 0) {
+      err(1, "Unable to start a search thread");
+    }
+  }
+  pthread_mutex_lock(&r.lock);
+  for (;;) {
+    /* Write whatever has come in at the front */
+    while (r.written < r.read && r.slot[r.written % r.nslots].done) {
+      sl = &r.slot[r.written % r.nslots];
+      fprintf(b->out, "%s %s\n", sl->line, sl->result);
+      r.written++;
+    }
+    if (r.eof && r.written == r.read) {
+      break;
+    } else if (r.eof || r.read - r.written == r.nslots) {
+      pthread_cond_wait(&r.done, &r.lock);
+      continue;
+    }
+    /* Nobody else looks at the slot until it's counted as read */
+    sl = &r.slot[r.read % r.nslots];
+    pthread_mutex_unlock(&r.lock);
+    if ((sl->toolong = (c = readline(b->in, sl->line)) == -1)) {
+      sl->line[0] = '\0';
+    }
+    sl->done = 0;
+    pthread_mutex_lock(&r.lock);
+    if (c == 0) {
+      r.eof = 1;
+      pthread_cond_broadcast(&r.work);
+    } else {
+      r.read++;
+      pthread_cond_signal(&r.work);
+    }
+  }
+  pthread_mutex_unlock(&r.lock);
+  for (i = 0; i < nthreads; i++) {
+    pthread_join(w[i].tid, NULL);
+    nodes += w[i].nodes;
+    ttfree(&w[i].tt);
+    free(w[i].s);
+  }
+  secs = walltime() - start;
+  fflush(b->out);
+  fprintf(stderr, "positions %lu in %.3f s (%.1f positions/s, %d thread%s)\n",
+	  r.read, secs, secs > 0 ? r.read / secs : 0.0, nthreads,
+	  nthreads == 1 ? "" : "s");
+  fprintf(stderr, "nodes %llu (%.0f nodes/s)\n", (unsigned long long)nodes,
+	  secs > 0 ? nodes / secs : 0.0);
+  pthread_cond_destroy(&r.work);
+  pthread_cond_destroy(&r.done);
+  pthread_mutex_destroy(&r.lock);
+  free(r.slot);
+  free(w);
+}
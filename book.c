@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Opening books, as written by mkbook and read by the search. A book
+ * says how games went after each move played from each position, up
+ * to symmetry. A file is
+ *
+ *	"NMMBOOK1", the game's name padded to 8 bytes,
+ *	the number of entries n (64 bits),
+ *	n entries of ENTRYLEN bytes: the key of the canonical position
+ *	(64 bits), the move in it (16 bits, then 16 bits of padding),
+ *	and the games, wins and draws for the player making the move
+ *	(32 bits each)
+ *
+ * all little-endian, with the entries sorted by key and then move so
+ * that a position's moves can be found by binary search in the mapped
+ * file without reading it in.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nmm.h"
+
+#define MAGIC "NMMBOOK1"
+#define HEADERLEN 24
+#define ENTRYLEN 24
+
+struct book {
+  const uint8_t	*map;
+  size_t	 len;
+  uint64_t	 n;
+  int		 type;
+};
+
+#define ENTRY(b, i)	((b)->map + HEADERLEN + (i) * ENTRYLEN)
+
+/*
+ * Where the symmetry putting g in canonical form takes m, setting
+ * *key to the canonical position's key. When the canonical position
+ * is itself symmetric, symmetric moves in it are the same move, and we
+ * take the smallest.
+ */
+move_t
+bookmove(const game *g, const move_t m, uint64_t *key)
+{
+  const struct topology *t = TOPO(g);
+  move_t cm, v;
+  game c;
+  int s;
+
+  s = canonical(g, &c);
+  cm = symmove(g, s, m);
+  for (s = 1; s < t->nsyms; s++) {
+    if (SYMBB(t, s, c.bb[WHITE]) == c.bb[WHITE] &&
+	SYMBB(t, s, c.bb[BLACK]) == c.bb[BLACK] &&
+	(v = symmove(&c, s, cm)) < cm) {
+      cm = v;
+    }
+  }
+  *key = c.key;
+  return cm;
+}
+
+/*
+ * Write the n entries at e, sorted by key and move, as the book for
+ * type. Returns 0, or -1 with errno set.
+ */
+int
+bookwrite(const char *path, const int type, const struct bookentry *e,
+	  const uint64_t n)
+{
+  uint8_t buf[HEADERLEN > ENTRYLEN ? HEADERLEN : ENTRYLEN];
+  uint64_t i;
+  FILE *f;
+  int ret = 0;
+
+  if (!(f = fopen(path, "wb"))) {
+    return -1;
+  }
+  memcpy(buf, MAGIC, 8);
+  memset(buf + 8, 0, 8);
+  memcpy(buf + 8, topo[type].name, strlen(topo[type].name));
+  put64(buf + 16, n);
+  if (fwrite(buf, 1, HEADERLEN, f) != HEADERLEN) {
+    ret = -1;
+  }
+  for (i = 0; i < n && ret == 0; i++) {
+    put64(buf, e[i].key);
+    put16(buf + 8, e[i].move);
+    put16(buf + 10, 0);
+    put32(buf + 12, e[i].games);
+    put32(buf + 16, e[i].wins);
+    put32(buf + 20, e[i].draws);
+    if (fwrite(buf, 1, ENTRYLEN, f) != ENTRYLEN) {
+      ret = -1;
+    }
+  }
+  if (fclose(f) == EOF) {
+    ret = -1;
+  }
+  return ret;
+}
+
+/*
+ * Map the book at path for game type. Returns NULL, with errno set, if
+ * it isn't one.
+ */
+struct book *
+bookopen(const char *path, const int type)
+{
+  struct book *b;
+  struct stat st;
+  char name[9] = { 0 };
+  void *map;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) == -1) {
+    return NULL;
+  }
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return NULL;
+  }
+  if (st.st_size < HEADERLEN) {
+    close(fd);
+    errno = EINVAL;
+    return NULL;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+  if (!(b = malloc(sizeof(*b)))) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  b->map = map;
+  b->len = st.st_size;
+  b->n = get64(b->map + 16);
+  b->type = type;
+  memcpy(name, b->map + 8, 8);
+  if (memcmp(b->map, MAGIC, 8) != 0 || strcmp(name, topo[type].name) != 0 ||
+      (b->len - HEADERLEN) / ENTRYLEN < b->n) {
+    bookclose(b);
+    errno = EINVAL;
+    return NULL;
+  }
+  return b;
+}
+
+void
+bookclose(struct book *b)
+{
+  munmap((void *)b->map, b->len);
+  free(b);
+}
+
+/*
+ * The move in g that has done best in the book's games, or NOMOVE if
+ * g isn't in the book. A move scores its wins and half its draws out
+ * of its games, counting one more win and one more loss than it had
+ * so that a move tried once doesn't look better than one that has
+ * nearly always won.
+ */
+move_t
+bookprobe(const struct book *b, const game *g)
+{
+  const struct topology *t = TOPO(g);
+  const uint8_t *e;
+  uint64_t lo = 0, hi = b->n, mid;
+  double score, best = -1;
+  move_t m = NOMOVE;
+  game c;
+  int s;
+
+  if (g->type != b->type) {
+    return NOMOVE;
+  }
+  s = canonical(g, &c);
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (get64(ENTRY(b, mid)) < c.key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (; lo < b->n && get64(e = ENTRY(b, lo)) == c.key; lo++) {
+    score = (get32(e + 16) + get32(e + 20) / 2.0 + 1) / (get32(e + 12) + 2);
+    if (score > best) {
+      best = score;
+      m = get16(e + 8);
+    }
+  }
+  m = symmove(&c, t->syminv[s], m);
+  return legalmove(g, m) ? m : NOMOVE;
+}
@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Endgame database files, as written by mkegdb and read by the
+ * search. Each file starts with a header
+ *
+ *	"NMMEGDB2", the game's name padded to 8 bytes,
+ *	m, o (32 bits each), the number of positions (64 bits),
+ *	EGBLOCK and the number of blocks n (32 bits each),
+ *	n + 1 offsets of the compressed blocks from the start of the file
+ *	(64 bits each)
+ *
+ * all little-endian, followed by the blocks themselves. A block is
+ * run-length encoded: a control byte c < 128 is followed by c + 1
+ * bytes to copy, and c >= 128 by one byte to repeat c - 125 times.
+ *
+ * Readers map the files rather than reading them, so that only the
+ * blocks that get probed are ever paged in and processes share them,
+ * and keep a small cache of decompressed blocks.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nmm.h"
+
+#define MAGIC "NMMEGDB2"
+#define HEADERLEN 40
+#define MAXRUN 130      /* longest run one control byte can repeat */
+#define MAXLIT 128      /* most bytes one control byte can copy */
+#define MAXPACKED (EGBLOCK + EGBLOCK / MAXLIT + 1)	/* worst case block */
+#define NSLOTS 256      /* blocks kept decompressed, a power of two */
+
+struct egfile {
+  const uint8_t	*map;		/* or NULL if there's no such file */
+  size_t	 len;
+  uint64_t	 nblocks;
+};
+
+struct egslot {
+  pthread_mutex_t lock;
+  int		 sub;		/* which file the block is from, or -1 */
+  uint64_t	 block;
+  uint8_t	 data[EGBLOCK];
+};
+
+struct egdb {
+  const struct topology *t;
+  struct symrank sr;
+  struct egfile	 f[MAXHAND + 1][MAXHAND + 1];
+  struct egslot	 slot[NSLOTS];
+};
+
+static size_t	 pack(const uint8_t *, const size_t, uint8_t *);
+static int	 unpack(const struct egfile *, const uint64_t, uint8_t *,
+			const size_t);
+static int	 mapfile(const char *, const struct symrank *, const int,
+			 const int, struct egfile *);
+
+/* ****
+ * Files
+ * **** */
+
+char *
+egpath(char *buf, const size_t len, const char *dir,
+       const struct topology *t, const int m, const int o)
+{
+  snprintf(buf, len, "%s/%s-%d-%d.egdb", dir, t->name, m, o);
+  return buf;
+}
+
+/*
+ * Run-length encode the len bytes at in, which must be at most
+ * EGBLOCK. out needs MAXPACKED bytes. Returns the encoded length.
+ */
+static size_t
+pack(const uint8_t *in, const size_t len, uint8_t *out)
+{
+  size_t i = 0, j, run, n = 0;
+
+  while (i < len) {
+    for (run = 1; i + run < len && run < MAXRUN && in[i + run] == in[i];
+	 run++)
+      ;
+    if (run >= 3) {
+      out[n++] = 128 + run - 3;
+      out[n++] = in[i];
+      i += run;
+      continue;
+    }
+    /* Copy up to the next run worth encoding */
+    for (j = i + 1; j < len && j - i < MAXLIT &&
+	   !(j + 2 < len && in[j] == in[j + 1] && in[j] == in[j + 2]); j++)
+      ;
+    out[n++] = j - i - 1;
+    memcpy(&out[n], &in[i], j - i);
+    n += j - i;
+    i = j;
+  }
+  return n;
+}
+
+/*
+ * Decompress block b of f into the len bytes at out. Returns 0, or -1
+ * if the block is damaged.
+ */
+static int
+unpack(const struct egfile *f, const uint64_t b, uint8_t *out,
+       const size_t len)
+{
+  const uint8_t *idx = f->map + HEADERLEN + 8 * b;
+  uint64_t start = get64(idx), end = get64(idx + 8);
+  const uint8_t *in, *stop;
+  size_t n = 0, c;
+
+  if (start > end || end > f->len) {
+    return -1;
+  }
+  for (in = f->map + start, stop = f->map + end; in < stop && n < len; ) {
+    c = *in++;
+    if (c >= 128) {
+      if (in == stop || n + c - 125 > len) {
+	return -1;
+      }
+      memset(&out[n], *in++, c - 125);
+      n += c - 125;
+    } else {
+      if ((size_t)(stop - in) < c + 1 || n + c + 1 > len) {
+	return -1;
+      }
+      memcpy(&out[n], in, c + 1);
+      in += c + 1;
+      n += c + 1;
+    }
+  }
+  return n == len && in == stop ? 0 : -1;
+}
+
+/*
+ * Write the size positions of val as the database for m against o.
+ * Returns 0, or -1 with errno set.
+ */
+int
+egwrite(const char *path, const struct symrank *sr, const int m, const int o,
+	const uint8_t *val)
+{
+  const struct topology *t = sr->t;
+  uint64_t size = symranksize(sr, m, o);
+  uint64_t nblocks = (size + EGBLOCK - 1) / EGBLOCK;
+  uint64_t b, off;
+  uint8_t hdr[HEADERLEN], buf[MAXPACKED], *idx;
+  size_t n, len;
+  FILE *f;
+  int ret = -1;
+
+  if (!(idx = malloc(8 * (nblocks + 1)))) {
+    return -1;
+  }
+  memcpy(hdr, MAGIC, 8);
+  memset(hdr + 8, 0, 8);
+  memcpy(hdr + 8, t->name, strlen(t->name));
+  put32(hdr + 16, m);
+  put32(hdr + 20, o);
+  put64(hdr + 24, size);
+  put32(hdr + 32, EGBLOCK);
+  put32(hdr + 36, nblocks);
+  if (!(f = fopen(path, "wb"))) {
+    goto done;
+  }
+  /* The index goes in once we know where the blocks end up */
+  off = HEADERLEN + 8 * (nblocks + 1);
+  if (fseeko(f, off, SEEK_SET) == -1) {
+    goto fail;
+  }
+  for (b = 0; b < nblocks; b++) {
+    put64(idx + 8 * b, off);
+    len = size - b * EGBLOCK < EGBLOCK ? size - b * EGBLOCK : EGBLOCK;
+    n = pack(val + b * EGBLOCK, len, buf);
+    if (fwrite(buf, 1, n, f) != n) {
+      goto fail;
+    }
+    off += n;
+  }
+  put64(idx + 8 * nblocks, off);
+  if (fseeko(f, 0, SEEK_SET) == -1 ||
+      fwrite(hdr, 1, HEADERLEN, f) != HEADERLEN ||
+      fwrite(idx, 8, nblocks + 1, f) != nblocks + 1) {
+    goto fail;
+  }
+  ret = 0;
+fail:
+  if (fclose(f) == EOF) {
+    ret = -1;
+  }
+done:
+  free(idx);
+  return ret;
+}
+
+/*
+ * Map the database for m against o, checking that it is one. Returns
+ * 0, or -1 with errno set.
+ */
+static int
+mapfile(const char *path, const struct symrank *sr, const int m,
+	const int o, struct egfile *f)
+{
+  const struct topology *t = sr->t;
+  struct stat st;
+  char name[9] = { 0 };
+  void *map;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) == -1) {
+    return -1;
+  }
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return -1;
+  }
+  if (st.st_size < HEADERLEN) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  f->map = map;
+  f->len = st.st_size;
+  f->nblocks = (symranksize(sr, m, o) + EGBLOCK - 1) / EGBLOCK;
+  memcpy(name, f->map + 8, 8);
+  if (memcmp(f->map, MAGIC, 8) != 0 || strcmp(name, t->name) != 0 ||
+      get32(f->map + 16) != (uint32_t)m ||
+      get32(f->map + 20) != (uint32_t)o ||
+      get64(f->map + 24) != symranksize(sr, m, o) ||
+      get32(f->map + 32) != EGBLOCK || get32(f->map + 36) != f->nblocks ||
+      f->len < HEADERLEN + 8 * (f->nblocks + 1)) {
+    munmap(map, f->len);
+    f->map = NULL;
+    errno = EINVAL;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Read the whole database for m against o into val. Returns 0, or -1
+ * with errno set.
+ */
+int
+egread(const char *path, const struct symrank *sr, const int m, const int o,
+       uint8_t *val)
+{
+  struct egfile f;
+  uint64_t b, size = symranksize(sr, m, o);
+  size_t len;
+  int ret = 0;
+
+  if (mapfile(path, sr, m, o, &f) == -1) {
+    return -1;
+  }
+  for (b = 0; b < f.nblocks && ret == 0; b++) {
+    len = size - b * EGBLOCK < EGBLOCK ? size - b * EGBLOCK : EGBLOCK;
+    if (unpack(&f, b, val + b * EGBLOCK, len) == -1) {
+      errno = EINVAL;
+      ret = -1;
+    }
+  }
+  munmap((void *)f.map, f.len);
+  return ret;
+}
+
+/* ****
+ * Probing
+ * **** */
+
+/*
+ * Map every database in dir for game type. Returns NULL, with errno
+ * set, if there are none.
+ */
+struct egdb *
+egopen(const char *dir, const int type)
+{
+  struct egdb *eg;
+  char path[FILENAME_MAX];
+  int m, o, found = 0;
+
+  if (!(eg = calloc(1, sizeof(*eg)))) {
+    return NULL;
+  }
+  for (m = 0; m < NSLOTS; m++) {
+    pthread_mutex_init(&eg->slot[m].lock, NULL);
+    eg->slot[m].sub = -1;
+  }
+  eg->t = &topo[type];
+  symrankinit(&eg->sr, eg->t);
+  for (m = 3; m <= eg->t->npieces; m++) {
+    for (o = 3; o <= eg->t->npieces; o++) {
+      egpath(path, sizeof(path), dir, eg->t, m, o);
+      if (access(path, F_OK) == -1) {
+	continue;
+      }
+      if (symrankadd(&eg->sr, m) == -1) {
+	egclose(eg);
+	errno = ENOMEM;
+	return NULL;
+      }
+      if (mapfile(path, &eg->sr, m, o, &eg->f[m][o]) == -1) {
+	egclose(eg);
+	return NULL;
+      }
+      found++;
+    }
+  }
+  if (!found) {
+    egclose(eg);
+    errno = ENOENT;
+    return NULL;
+  }
+  return eg;
+}
+
+void
+egclose(struct egdb *eg)
+{
+  int m, o;
+
+  for (m = 0; m <= MAXHAND; m++) {
+    for (o = 0; o <= MAXHAND; o++) {
+      if (eg->f[m][o].map) {
+	munmap((void *)eg->f[m][o].map, eg->f[m][o].len);
+      }
+    }
+  }
+  for (m = 0; m < NSLOTS; m++) {
+    pthread_mutex_destroy(&eg->slot[m].lock);
+  }
+  symrankfree(&eg->sr);
+  free(eg);
+}
+
+/*
+ * Look g up. Returns its byte in the database, or -1 if it isn't in
+ * one: there are pieces to place or a removal pending, or that file
+ * is missing or damaged.
+ */
+int
+egprobe(struct egdb *eg, const game *g)
+{
+  const struct egfile *f;
+  struct egslot *sl;
+  int s = g->state, m, o, sub, v = -1;
+  uint64_t i, b, size;
+
+  if (g->remove || g->inhand[WHITE] || g->inhand[BLACK]) {
+    return -1;
+  }
+  m = g->pieces[s];
+  o = g->pieces[s ^ BLACK];
+  if (m < 3 || o < 3 || !(f = &eg->f[m][o])->map) {
+    return -1;
+  }
+  i = symrankpos(&eg->sr, m, o, g->bb[s], g->bb[s ^ BLACK]);
+  b = i / EGBLOCK;
+  sub = m * (MAXHAND + 1) + o;
+  sl = &eg->slot[(b * 31 + sub) & (NSLOTS - 1)];
+  pthread_mutex_lock(&sl->lock);
+  if (sl->sub != sub || sl->block != b) {
+    size = symranksize(&eg->sr, m, o);
+    sl->sub = -1;
+    if (unpack(f, b, sl->data, size - b * EGBLOCK < EGBLOCK ?
+	       size - b * EGBLOCK : EGBLOCK) == 0) {
+      sl->sub = sub;
+      sl->block = b;
+    }
+  }
+  if (sl->sub == sub) {
+    v = sl->data[i % EGBLOCK];
+  }
+  pthread_mutex_unlock(&sl->lock);
+  return v;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The rules that run at every node of a search, written once and
+ * compiled once per game. tables.c includes this after the boards'
+ * tables, once for each game, with VARIANT set to the game's number
+ * and KNAME(f) naming that game's copy of f, and gathers the copies
+ * into kernels[]. Each copy has its board known at compile time: the
+ * sizes, masks and rules of the board are constants to it, and there
+ * is no lookup of the game's type from one call to the next.
+ *
+ * This is not a header in the usual sense. It's included more than
+ * once, and only from tables.c.
+ */
+
+/* Every board in here is the one board */
+#undef TOPO
+#define TOPO(g)		(&topo[VARIANT])
+
+static int	 KNAME(coordpoint)(const char *);
+static int	 KNAME(closesmill)(const bitboard, const int);
+static bitboard	 KNAME(millpieces)(const bitboard);
+static bitboard	 KNAME(removable)(const bitboard);
+static int	 KNAME(winner)(const game *);
+static int	 KNAME(genmoves)(const game *, move_t *);
+static void	 KNAME(setphase)(game *);
+static void	 KNAME(countlines)(game *, const int, const int, const int);
+static void	 KNAME(putpiece)(game *, const int, const int);
+static void	 KNAME(takepiece)(game *, const int, const int);
+static void	 KNAME(endturn)(game *);
+static void	 KNAME(makemove)(game *, const move_t);
+
+/*
+ * Given coordinates such as `a1', retrieve the corresponding point, or
+ * NOPOINT if there is none. Assumes coords are lower case.
+ */
+static int
+KNAME(coordpoint)(const char *coords)
+{
+  const struct topology *t = &topo[VARIANT];
+  int c = coords[0] - 'a';
+  int r = coords[1] - '1';
+
+  if (c < 0 || t->side <= c || r < 0 || t->side <= r) {
+    return NOPOINT;
+  }
+  return t->at[c][r];
+}
+
+/*
+ * Does the piece of own on p make a mill? Only the mills through p
+ * are looked at.
+ */
+static int
+KNAME(closesmill)(const bitboard own, const int p)
+{
+  const struct topology *t = &topo[VARIANT];
+  int k;
+
+  for (k = 0; k < t->npmills[p]; k++) {
+    if ((own & t->pmills[p][k]) == t->pmills[p][k]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Those pieces of own that are part of a mill
+ */
+static bitboard
+KNAME(millpieces)(const bitboard own)
+{
+  const struct topology *t = &topo[VARIANT];
+  bitboard inmills = 0;
+  int i;
+
+  for (i = 0; i < t->nmills; i++) {
+    if ((own & t->mills[i]) == t->mills[i]) {
+      inmills |= t->mills[i];
+    }
+  }
+  return inmills;
+}
+
+/*
+ * Those pieces of opp that may be removed after a mill. Pieces in
+ * mills are only fair game when nothing else is.
+ */
+static bitboard
+KNAME(removable)(const bitboard opp)
+{
+  bitboard b;
+
+  if (!(b = opp & ~KNAME(millpieces)(opp))) {
+    b = opp;
+  }
+  return b;
+}
+
+/*
+ * Has the game been decided? Returns the winning colour, or NOCOLOUR
+ * while play continues. The player to move loses once they can no
+ * longer get three pieces on the board, or when they cannot move.
+ */
+static int
+KNAME(winner)(const game *g)
+{
+  int s = g->state;
+
+  if (g->remove) {
+    return NOCOLOUR;
+  }
+  if (g->pieces[s] + g->inhand[s] < 3) {
+    return s ^ BLACK;
+  }
+  if (g->inhand[s]) {
+    return EMPTIES(g) ? NOCOLOUR : s ^ BLACK;
+  }
+  /* Blocked: none of their pieces has a free neighbour */
+  if (!FLIES(g, s) && g->f.mob[s] == 0) {
+    return s ^ BLACK;
+  }
+  return NOCOLOUR;
+}
+
+/*
+ * Store every legal move for the player to move in moves, which must
+ * have room for MAXMOVES, and return how many there are. Finished
+ * games have no moves.
+ */
+static int
+KNAME(genmoves)(const game *g, move_t *moves)
+{
+  const struct topology *t = TOPO(g);
+  int s = g->state;
+  bitboard own = g->bb[s];
+  bitboard opp = g->bb[s ^ BLACK];
+  bitboard empty = t->all & ~(own | opp);
+  bitboard b, to;
+  move_t *m = moves;
+  int p;
+
+  if (g->remove) {
+    for (b = KNAME(removable)(opp); b; b &= b - 1) {
+      *m++ = MOVE(REMOVE, 0, lowbit(b));
+    }
+    return m - moves;
+  }
+  if (g->pieces[s] + g->inhand[s] < 3) {
+    return 0;
+  }
+  if (g->inhand[s]) {
+    for (b = empty; b; b &= b - 1) {
+      *m++ = MOVE(PLACE, 0, lowbit(b));
+    }
+  }
+  if (FLIES(g, s)) {
+    for (b = own; b; b &= b - 1) {
+      p = lowbit(b);
+      for (to = empty; to; to &= to - 1) {
+	*m++ = MOVE(JUMP, p, lowbit(to));
+      }
+    }
+  } else if (!g->inhand[s] || t->moveinhand) {
+    for (b = own; b; b &= b - 1) {
+      p = lowbit(b);
+      for (to = t->adj[p] & empty; to; to &= to - 1) {
+	*m++ = MOVE(SLIDE, p, lowbit(to));
+      }
+    }
+  }
+  return m - moves;
+}
+
+/*
+ * Work out the phase from the piece counts
+ */
+static void
+KNAME(setphase)(game *g)
+{
+  if (g->inhand[WHITE] || g->inhand[BLACK]) {
+    g->phase = 1;
+  } else if (FLIES(g, WHITE) || FLIES(g, BLACK)) {
+    g->phase = 3;
+  } else {
+    g->phase = 2;
+  }
+}
+
+/*
+ * Count the mill lines through p as having a piece of colour c at p
+ * rather than p free, or with sign -1, the other way round. Only the
+ * other two points of each line need looking at.
+ */
+static void
+KNAME(countlines)(game *g, const int c, const int p, const int sign)
+{
+  const struct topology *t = TOPO(g);
+  bitboard l;
+  int k, own, opp;
+
+  for (k = 0; k < t->npmills[p]; k++) {
+    l = t->pmills[p][k];
+    own = popcount(g->bb[c] & l);
+    opp = popcount(g->bb[c ^ BLACK] & l);
+    g->f.mills[c] += sign * (own == 2);
+    g->f.twos[c] += sign * ((own == 1 && opp == 0) - (own == 2));
+    g->f.twos[c ^ BLACK] -= sign * (opp == 2);
+  }
+}
+
+/*
+ * Put a piece of colour c on the empty point p. It gets the empty
+ * neighbours of p, and the pieces next to p lose p.
+ */
+static void
+KNAME(putpiece)(game *g, const int c, const int p)
+{
+  const struct topology *t = TOPO(g);
+
+  KNAME(countlines)(g, c, p, 1);
+  g->bb[c] |= BIT(p);
+  g->key ^= zobrist.piece[c][p];
+  g->f.mob[c] += popcount(t->adj[p] & EMPTIES(g));
+  g->f.mob[WHITE] -= popcount(t->adj[p] & g->bb[WHITE]);
+  g->f.mob[BLACK] -= popcount(t->adj[p] & g->bb[BLACK]);
+}
+
+/*
+ * Take colour c's piece off p, undoing putpiece
+ */
+static void
+KNAME(takepiece)(game *g, const int c, const int p)
+{
+  const struct topology *t = TOPO(g);
+
+  KNAME(countlines)(g, c, p, -1);
+  g->bb[c] &= ~BIT(p);
+  g->key ^= zobrist.piece[c][p];
+  g->f.mob[c] -= popcount(t->adj[p] & EMPTIES(g));
+  g->f.mob[WHITE] += popcount(t->adj[p] & g->bb[WHITE]);
+  g->f.mob[BLACK] += popcount(t->adj[p] & g->bb[BLACK]);
+}
+
+/*
+ * Pass the move to the opponent
+ */
+static void
+KNAME(endturn)(game *g)
+{
+  g->state ^= BLACK;
+  g->key ^= zobrist.side;
+  KNAME(setphase)(g);
+}
+
+/*
+ * Play the legal move m. If it closes a mill and the opponent has a
+ * piece on the board, the player keeps the move to make a removal.
+ */
+static void
+KNAME(makemove)(game *g, const move_t m)
+{
+  int s = g->state;
+  int to = MOVETO(m);
+
+#if defined(CHECKFEATURES)
+  checkfeatures(g);
+#endif
+  switch (MOVEKIND(m))
+  {
+  case PLACE:
+    KNAME(putpiece)(g, s, to);
+    g->key ^= zobrist.inhand[s][g->inhand[s]] ^
+      zobrist.inhand[s][g->inhand[s] - 1];
+    g->inhand[s]--;
+    g->pieces[s]++;
+    break;
+
+  case SLIDE:
+  case JUMP:
+    KNAME(takepiece)(g, s, MOVEFROM(m));
+    KNAME(putpiece)(g, s, to);
+    break;
+
+  case REMOVE:
+    KNAME(takepiece)(g, s ^ BLACK, to);
+    g->key ^= zobrist.remove;
+    g->pieces[s ^ BLACK]--;
+    g->remove = 0;
+    KNAME(endturn)(g);
+    return;
+  }
+  if (g->bb[s ^ BLACK] && KNAME(closesmill)(g->bb[s], to)) {
+    g->remove = 1;
+    g->key ^= zobrist.remove;
+    return;
+  }
+  KNAME(endturn)(g);
+}
+
+/* Back to the board of the game at hand, as in nmm.h */
+#undef TOPO
+#define TOPO(g)		(&topo[(g)->type])
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Build an opening book from game records, such as those printed by
+ * nmm -s -v. For each position up to symmetry reached while pieces
+ * are being placed, and each move played from it, we count the
+ * finished games and how many the player making the move won and
+ * drew.
+ *
+ * Counts are gathered in an array that is sorted, and entries for the
+ * same position and move merged, whenever it fills up, so that memory
+ * grows with the number of different entries rather than of games.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nmm.h"
+
+static struct bookentry *e;
+static size_t n, size = 1 << 20;
+
+__BEGIN_DECLS
+int	 entrycmp(const void *, const void *);
+void	 merge(void);
+void	 add(const game *, const move_t, const int);
+int	 addgame(struct recreader *, struct record *, const int);
+__dead void	 usage(const char *);
+int	 main(int, char **);
+__END_DECLS
+
+int
+entrycmp(const void *a, const void *b)
+{
+  const struct bookentry *x = a, *y = b;
+
+  if (x->key != y->key) {
+    return x->key < y->key ? -1 : 1;
+  }
+  return (int)x->move - (int)y->move;
+}
+
+/*
+ * Sort the entries and add up those for the same position and move
+ */
+void
+merge(void)
+{
+  size_t i, j;
+
+  qsort(e, n, sizeof(*e), entrycmp);
+  for (i = 0, j = 1; j < n; j++) {
+    if (entrycmp(&e[i], &e[j]) == 0) {
+      e[i].games += e[j].games;
+      e[i].wins += e[j].wins;
+      e[i].draws += e[j].draws;
+    } else {
+      e[++i] = e[j];
+    }
+  }
+  n = n ? i + 1 : 0;
+}
+
+/*
+ * Count a game in which m was played from g and w won
+ */
+void
+add(const game *g, const move_t m, const int w)
+{
+  struct bookentry *ne;
+
+  if (n == size) {
+    merge();
+    /* Make room if merging didn't free up enough */
+    if (n > size / 2) {
+      if (!(ne = realloc(e, 2 * size * sizeof(*e)))) {
+	err(ENOMEM, "Unable to grow the book");
+      }
+      e = ne;
+      size *= 2;
+    }
+  }
+  e[n].move = bookmove(g, m, &e[n].key);
+  e[n].games = 1;
+  e[n].wins = (w == g->state);
+  e[n].draws = (w == NOCOLOUR);
+  n++;
+}
+
+/*
+ * Count the moves of the game r has started on, up to the end of the
+ * first phase or maxplies. Returns 1 if the game was counted, 0 if it
+ * wasn't finished, or -1 if it isn't a legal game.
+ */
+int
+addgame(struct recreader *r, struct record *rec, const int maxplies)
+{
+  game g[MAXPLY];
+  move_t m[MAXPLY], rest;
+  int i, got, ply = 0;
+
+  /* Read the whole game, for its result, before counting any of it */
+  do {
+    if (ply < maxplies && ply < MAXPLY && rec->g.phase == 1) {
+      g[ply] = rec->g;
+      if ((got = rdmove(r, rec, &m[ply])) == 1) {
+	ply++;
+      }
+    } else {
+      got = rdmove(r, rec, &rest);
+    }
+  } while (got == 1);
+  if (got == -1) {
+    return -1;
+  } else if (rec->result == UNFINISHED) {
+    return 0;
+  }
+  for (i = 0; i < ply; i++) {
+    add(&g[i], m[i], rec->result);
+  }
+  return 1;
+}
+
+__dead void
+usage(const char *bn)
+{
+  fprintf(stderr, "usage: %s [-m games] [-n plies] [-o file] [game]\n", bn);
+  exit(EINVAL);
+}
+
+/*
+ * Read games from stdin and write the entries played at least mingames
+ * times
+ */
+int
+main(int argc, char *argv[])
+{
+  static struct recreader r;
+  struct record rec;
+  const char *bn = argv[0], *out = NULL;
+  char path[64];
+  size_t i, j;
+  unsigned long games = 0, unfinished = 0;
+  int c, mingames = 1, maxplies = MAXPLY, type;
+
+  while ((c = getopt(argc, argv, "m:n:o:")) != -1) {
+    switch (c)
+    {
+    case 'm':
+      mingames = atoi(optarg);
+      break;
+
+    case 'n':
+      maxplies = atoi(optarg);
+      break;
+
+    case 'o':
+      out = optarg;
+      break;
+
+    default:
+      usage(bn);
+    }
+  }
+  argc -= optind;
+  argv += optind;
+  if (argc > 1) {
+    usage(bn);
+  }
+  for (type = 0; type < NVARIANTS; type++) {
+    if (strcmp(argc ? argv[0] : "nmm", topo[type].name) == 0) {
+      break;
+    }
+  }
+  if (type == NVARIANTS) {
+    errx(EINVAL, "Unknown game: %s", argv[0]);
+  }
+  if (!out) {
+    snprintf(path, sizeof(path), "%s.book", topo[type].name);
+    out = path;
+  }
+  if (!(e = malloc(size * sizeof(*e)))) {
+    err(ENOMEM, "Unable to allocate the book");
+  }
+  rdinit(&r, stdin, type);
+  while ((c = rdgame(&r, &rec)) != 0) {
+    if (c == 1 && rec.start.type != type) {
+      warnx("Game at line %lu is not a game of %s", r.gameline,
+	    topo[type].name);
+    } else if (c == -1 || (c = addgame(&r, &rec, maxplies)) == -1) {
+      warnx("Game at line %lu, line %lu: %s", r.gameline, r.line, r.error);
+    } else if (c == 0) {
+      unfinished++;
+    } else {
+      games++;
+    }
+  }
+  if (ferror(stdin)) {
+    err(errno, "Unable to read the games");
+  }
+  merge();
+  for (i = 0, j = 0; i < n; i++) {
+    if (e[i].games >= (uint32_t)mingames) {
+      e[j++] = e[i];
+    }
+  }
+  if (bookwrite(out, type, e, j) == -1) {
+    err(errno, "Unable to write %s", out);
+  }
+  printf("%lu games, %lu unfinished, %lu entries written to %s\n", games,
+	 unfinished, (unsigned long)j, out);
+  free(e);
+  return 0;
+}
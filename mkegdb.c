@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Solve the endgame of a Morris variant by retrograde analysis: once
+ * both players have placed all their pieces, find out for every
+ * position whether the player to move wins, loses or draws with best
+ * play, and how many moves a win or loss takes.
+ *
+ * Positions are grouped into subspaces by how many pieces the player
+ * to move and the other player have. A move without a mill leads from
+ * subspace (m, o) to (o, m), so the two are solved together; a mill
+ * leads to (o - 1, m), which has one piece fewer in all and so is
+ * solved first. Within a pair, positions are settled in rounds: round
+ * k settles everything decided in exactly k moves, by unmaking moves
+ * from the positions settled in round k - 1. Each round is shared out
+ * between threads.
+ *
+ * Each subspace is written to its own file, in the format described
+ * in egdb.c.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nmm.h"
+
+#define CHUNK 65536	/* positions handed to a thread at a time */
+
+#if defined(__GNUC__)
+#define CAS(p, o, n)	__atomic_compare_exchange_n((p), &(o), (n), 0, \
+						    __ATOMIC_RELAXED, \
+						    __ATOMIC_RELAXED)
+#define DEC(p)		__atomic_sub_fetch((p), 1, __ATOMIC_RELAXED)
+#else
+/* Without atomics we run single-threaded, see main */
+#define CAS(p, o, n)	(*(p) == (o) ? (*(p) = (n), 1) : ((o) = *(p), 0))
+#define DEC(p)		(--*(p))
+#endif
+
+#define MAX(a, b)	((a) > (b) ? (a) : (b))
+
+/*
+ * One subspace: every position where the player to move has m pieces
+ * and the other player o, all on the board.
+ */
+struct table {
+  int		 m;
+  int		 o;
+  uint64_t	 size;
+  uint8_t	*val;
+  uint8_t	*cnt;		/* moves not yet known to lose, while solving */
+};
+
+/*
+ * A pass over one table, shared out between threads a chunk at a time
+ */
+struct pass {
+  void		(*fn)(struct pass *, uint64_t, uint64_t, int *);
+  struct table	*tab;
+  int		 round;
+  pthread_mutex_t lock;
+  uint64_t	 next;		/* first position not yet handed out */
+  int		 longest;	/* longest distance written */
+};
+
+static const struct topology *t;
+static const struct kernel *rules;	/* t's, as the game plays them */
+static struct symrank sr;
+static struct table *tabs[MAXHAND + 1][MAXHAND + 1];
+static const char *dir = ".";
+static int nthreads;
+
+__BEGIN_DECLS
+int	 captures(const struct table *, const bitboard, const bitboard,
+		  int *, int *);
+void	 setval(uint8_t *, const int, int *);
+int	 adduniq(uint64_t *, const int, const uint64_t);
+void	 initpass(struct pass *, uint64_t, uint64_t, int *);
+void	 roundpass(struct pass *, uint64_t, uint64_t, int *);
+void	*worker(void *);
+int	 runpass(void (*)(struct pass *, uint64_t, uint64_t, int *),
+		 struct table *, const int);
+struct table *newtable(const int, const int);
+int	 loadtable(struct table *);
+void	 savetable(const struct table *);
+void	 report(const struct table *, const double);
+void	 solve(const int, const int);
+__dead void	 usage(const char *);
+int	 main(int, char **);
+__END_DECLS
+
+/* ****
+ * Rules
+ * **** */
+
+/*
+ * Look up every removal after the player to move in tab has made a
+ * mill, leaving them on mover and the other player on other. Returns
+ * the shortest win found for the player who made the mill, or -1 if
+ * there is none; *longest is set to the longest loss and *draw if
+ * any removal draws.
+ */
+int
+captures(const struct table *tab, const bitboard mover, const bitboard other,
+	 int *longest, int *draw)
+{
+  const struct table *next;
+  bitboard b;
+  int v, win = -1;
+
+  if (tab->o - 1 < 3) {
+    /* They're down to two pieces */
+    return 1;
+  }
+  next = tabs[tab->o - 1][tab->m];
+  for (b = rules->removable(other); b; b &= b - 1) {
+    v = next->val[symrankpos(&sr, next->m, next->o, other & ~BIT(lowbit(b)),
+			     mover)];
+    if (EGISLOSS(v)) {
+      if (win == -1 || EGDIST(v) + 1 < win) {
+	win = EGDIST(v) + 1;
+      }
+    } else if (EGISWIN(v)) {
+      if (EGDIST(v) + 1 > *longest) {
+	*longest = EGDIST(v) + 1;
+      }
+    } else {
+      *draw = 1;
+    }
+  }
+  return win;
+}
+
+/* ****
+ * Solving
+ * **** */
+
+/*
+ * Settle a position as decided in d moves
+ */
+void
+setval(uint8_t *v, const int d, int *longest)
+{
+  if (EGVAL(d) > EGMAXVAL) {
+    errx(ERANGE, "Some position takes more than %d moves", EGMAXVAL - 1);
+  }
+  *v = EGVAL(d);
+  if (d > *longest) {
+    *longest = d;
+  }
+}
+
+/*
+ * Add j to the n numbers in set if it isn't there already, returning
+ * how many there are now
+ */
+int
+adduniq(uint64_t *set, const int n, const uint64_t j)
+{
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (set[i] == j) {
+      return n;
+    }
+  }
+  set[n] = j;
+  return n + 1;
+}
+
+/*
+ * Settle the positions that are decided without looking at the rest
+ * of their own pair of subspaces: those where the player to move is
+ * stuck, or can win with a mill, or has nothing but mills that lose.
+ * Wins found here may yet turn out to be shorter. Everything else
+ * gets a count of the positions within the pair its moves lead to.
+ *
+ * That's positions up to symmetry, rather than moves: two moves may
+ * lead to symmetric positions, and a symmetric position reached by
+ * one move can be reached from several of our symmetric copies, so
+ * counting moves wouldn't match the unmoves roundpass finds.
+ */
+void
+initpass(struct pass *p, uint64_t lo, uint64_t hi, int *longest)
+{
+  const struct table *tab = p->tab;
+  bitboard mover, other, empty, own, b, to;
+  uint64_t next[MAXMOVES];
+  int from, n, internal, win, w, loss, draw;
+  uint64_t i;
+
+  for (i = lo; i < hi; i++) {
+    symunrankpos(&sr, tab->m, tab->o, i, &mover, &other);
+    if (symrankpos(&sr, tab->m, tab->o, mover, other) != i) {
+      /* Unused: a symmetric copy of some other position */
+      tab->cnt[i] = 0;
+      continue;
+    }
+    empty = t->all & ~(mover | other);
+    n = internal = draw = 0;
+    win = loss = -1;
+    for (b = mover; b; b &= b - 1) {
+      from = lowbit(b);
+      to = tab->m <= t->fly ? empty : t->adj[from] & empty;
+      for (; to; to &= to - 1, n++) {
+	own = mover ^ BIT(from) ^ BIT(lowbit(to));
+	if (!rules->closesmill(own, lowbit(to))) {
+	  internal = adduniq(next, internal,
+			     symrankpos(&sr, tab->o, tab->m, other, own));
+	} else if ((w = captures(tab, own, other, &loss, &draw)) != -1 &&
+		   (win == -1 || w < win)) {
+	  win = w;
+	}
+      }
+    }
+    tab->cnt[i] = internal;
+    if (n == 0) {
+      setval(&tab->val[i], 0, longest);
+    } else if (win != -1) {
+      setval(&tab->val[i], win, longest);
+    } else if (internal == 0 && !draw) {
+      setval(&tab->val[i], loss, longest);
+    }
+  }
+}
+
+/*
+ * Round k: unmake the moves leading to each position settled in k
+ * moves. If it loses, whoever moved there wins in k + 1. If it wins,
+ * that's one fewer position left for them to try, and once none are
+ * left they lose.
+ */
+void
+roundpass(struct pass *p, uint64_t lo, uint64_t hi, int *longest)
+{
+  const struct table *tab = p->tab;
+  struct table *prev = tabs[tab->o][tab->m];
+  bitboard mover, other, empty, pmover, b, x, y, to;
+  bitboard pmovers[MAXMOVES];
+  uint64_t prevs[MAXMOVES];
+  uint8_t v, old, want;
+  int loss, draw, from, k, n;
+  uint64_t i, j;
+
+  if (EGVAL(p->round + 1) > EGMAXVAL) {
+    errx(ERANGE, "Some position takes more than %d moves", EGMAXVAL - 1);
+  }
+  want = EGVAL(p->round + 1);
+  for (i = lo; i < hi; i++) {
+    if ((v = tab->val[i]) != EGVAL(p->round)) {
+      continue;
+    }
+    symunrankpos(&sr, tab->m, tab->o, i, &mover, &other);
+    empty = t->all & ~(mover | other);
+    /* The other player just moved a piece to y, without making a mill */
+    for (n = 0, y = other; y; y &= y - 1) {
+      if (rules->closesmill(other, lowbit(y))) {
+	continue;
+      }
+      x = tab->o <= t->fly ? empty : t->adj[lowbit(y)] & empty;
+      for (; x; x &= x - 1) {
+	pmover = other ^ BIT(lowbit(y)) ^ BIT(lowbit(x));
+	j = symrankpos(&sr, prev->m, prev->o, pmover, mover);
+	if ((k = adduniq(prevs, n, j)) > n) {
+	  pmovers[n] = pmover;
+	  n = k;
+	}
+      }
+    }
+    for (k = 0; k < n; k++) {
+      j = prevs[k];
+      pmover = pmovers[k];
+      if (EGISLOSS(v)) {
+	old = prev->val[j];
+	while (old == EGDRAW || (EGISWIN(old) && old > want)) {
+	  if (CAS(&prev->val[j], old, want)) {
+	    *longest = MAX(*longest, p->round + 1);
+	    break;
+	  }
+	}
+      } else if (prev->val[j] == EGDRAW && DEC(&prev->cnt[j]) == 0) {
+	/* Every move within the pair loses; what about the mills? */
+	loss = p->round + 1;
+	draw = 0;
+	for (b = pmover; b; b &= b - 1) {
+	  from = lowbit(b);
+	  to = prev->m <= t->fly ? t->all & ~(pmover | mover) :
+	    t->adj[from] & ~(pmover | mover);
+	  for (; to; to &= to - 1) {
+	    if (rules->closesmill(pmover ^ BIT(from) ^ BIT(lowbit(to)),
+				  lowbit(to))) {
+	      captures(prev, pmover ^ BIT(from) ^ BIT(lowbit(to)), mover,
+		       &loss, &draw);
+	    }
+	  }
+	}
+	if (!draw) {
+	  setval(&prev->val[j], loss, longest);
+	}
+      }
+    }
+  }
+}
+
+void *
+worker(void *arg)
+{
+  struct pass *p = arg;
+  uint64_t lo;
+  int longest = -1;
+
+  for (;;) {
+    pthread_mutex_lock(&p->lock);
+    lo = p->next;
+    p->next += CHUNK;
+    pthread_mutex_unlock(&p->lock);
+    if (lo >= p->tab->size) {
+      break;
+    }
+    p->fn(p, lo, lo + CHUNK < p->tab->size ? lo + CHUNK : p->tab->size,
+	  &longest);
+  }
+  pthread_mutex_lock(&p->lock);
+  if (longest > p->longest) {
+    p->longest = longest;
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+/*
+ * Run fn over all of tab with every thread. Returns the longest
+ * distance settled, or -1 if nothing was.
+ */
+int
+runpass(void (*fn)(struct pass *, uint64_t, uint64_t, int *),
+	struct table *tab, const int round)
+{
+  pthread_t tid[MAXTHREADS];
+  struct pass p;
+  int i;
+
+  p.fn = fn;
+  p.tab = tab;
+  p.round = round;
+  p.next = 0;
+  p.longest = -1;
+  pthread_mutex_init(&p.lock, NULL);
+  for (i = 1; i < nthreads; i++) {
+    if (pthread_create(&tid[i], NULL, worker, &p) != 0) {
+      err(1, "Unable to start thread");
+    }
+  }
+  worker(&p);
+  for (i = 1; i < nthreads; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  pthread_mutex_destroy(&p.lock);
+  return p.longest;
+}
+
+/* ****
+ * Files
+ * **** */
+
+struct table *
+newtable(const int m, const int o)
+{
+  struct table *tab;
+
+  if (!(tab = calloc(1, sizeof(*tab)))) {
+    err(1, "Unable to allocate a table");
+  }
+  tab->m = m;
+  tab->o = o;
+  tab->size = symranksize(&sr, m, o);
+  if (!(tab->val = calloc(tab->size, 1))) {
+    err(1, "Unable to allocate %d-%d", m, o);
+  }
+  tabs[m][o] = tab;
+  return tab;
+}
+
+/*
+ * Read tab in if it has already been solved. Returns non-zero if so.
+ */
+int
+loadtable(struct table *tab)
+{
+  char path[FILENAME_MAX];
+
+  egpath(path, sizeof(path), dir, t, tab->m, tab->o);
+  if (egread(path, &sr, tab->m, tab->o, tab->val) == -1) {
+    if (errno != ENOENT) {
+      err(errno, "Unable to read %s", path);
+    }
+    return 0;
+  }
+  return 1;
+}
+
+void
+savetable(const struct table *tab)
+{
+  char path[FILENAME_MAX];
+
+  egpath(path, sizeof(path), dir, t, tab->m, tab->o);
+  if (egwrite(path, &sr, tab->m, tab->o, tab->val) == -1) {
+    err(errno, "Unable to write %s", path);
+  }
+}
+
+void
+report(const struct table *tab, const double secs)
+{
+  uint64_t wins = 0, losses = 0, draws = 0, i;
+  bitboard mover, other;
+  int longest = 0;
+
+  for (i = 0; i < tab->size; i++) {
+    if (EGISWIN(tab->val[i])) {
+      wins++;
+    } else if (EGISLOSS(tab->val[i])) {
+      losses++;
+    } else {
+      symunrankpos(&sr, tab->m, tab->o, i, &mover, &other);
+      draws += symrankpos(&sr, tab->m, tab->o, mover, other) == i;
+    }
+    if (tab->val[i] && EGDIST(tab->val[i]) > longest) {
+      longest = EGDIST(tab->val[i]);
+    }
+  }
+  printf("%s-%d-%d: %llu entries, %llu wins, %llu losses, %llu draws, "
+	 "longest %d moves, %.3f s\n", t->name, tab->m, tab->o,
+	 (unsigned long long)tab->size, (unsigned long long)wins,
+	 (unsigned long long)losses, (unsigned long long)draws, longest, secs);
+  fflush(stdout);
+}
+
+/*
+ * Solve the subspaces (m, o) and (o, m) together, unless they're
+ * already on disk
+ */
+void
+solve(const int m, const int o)
+{
+  struct table *a, *b;
+  double start = walltime();
+  int k, n, top;
+
+  a = newtable(m, o);
+  b = m == o ? a : newtable(o, m);
+  if (loadtable(a) && (b == a || loadtable(b))) {
+    return;
+  }
+  if (!(a->cnt = malloc(a->size)) || !(b->cnt = b == a ? a->cnt :
+				       malloc(b->size))) {
+    err(1, "Unable to allocate move counts for %d-%d", m, o);
+  }
+  top = runpass(initpass, a, 0);
+  if (b != a && (n = runpass(initpass, b, 0)) > top) {
+    top = n;
+  }
+  for (k = 0; k <= top; k++) {
+    if ((n = runpass(roundpass, a, k)) > top) {
+      top = n;
+    }
+    if (b != a && (n = runpass(roundpass, b, k)) > top) {
+      top = n;
+    }
+  }
+  if (b != a) {
+    free(b->cnt);
+  }
+  free(a->cnt);
+  savetable(a);
+  report(a, walltime() - start);
+  if (b != a) {
+    savetable(b);
+    report(b, walltime() - start);
+  }
+}
+
+__dead void
+usage(const char *bn)
+{
+  fprintf(stderr, "usage: %s [-d directory] [-j threads] [-n pieces] "
+	  "[game]\n", bn);
+  exit(EINVAL);
+}
+
+/*
+ * Solve every subspace with at most n pieces a side, in order of the
+ * total number of pieces, dropping tables once nothing needs them.
+ */
+int
+main(int argc, char *argv[])
+{
+  int c, m, o, n = -1, total, type;
+  const char *bn = argv[0];
+
+  nthreads = ncpus();
+  while ((c = getopt(argc, argv, "d:j:n:")) != -1) {
+    switch (c)
+    {
+    case 'd':
+      dir = optarg;
+      break;
+
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+
+    case 'n':
+      n = atoi(optarg);
+      break;
+
+    default:
+      usage(bn);
+    }
+  }
+  argc -= optind;
+  argv += optind;
+  if (argc > 1) {
+    usage(bn);
+  }
+  for (type = 0; type < NVARIANTS; type++) {
+    if (strcmp(argc ? argv[0] : "nmm", topo[type].name) == 0) {
+      break;
+    }
+  }
+  if (type == NVARIANTS) {
+    errx(EINVAL, "Unknown game: %s", argv[0]);
+  }
+  t = &topo[type];
+  rules = &kernels[type];
+  if (n == -1) {
+    n = t->npieces;
+  } else if (n < 3 || n > t->npieces) {
+    errx(EINVAL, "Pieces must be between 3 and %d", t->npieces);
+  }
+  symrankinit(&sr, t);
+  for (m = 3; m <= n; m++) {
+    if (symrankadd(&sr, m) == -1) {
+      err(ENOMEM, "Unable to number the positions");
+    }
+  }
+#if !defined(__GNUC__)
+  nthreads = 1;
+#endif
+  if (nthreads < 1) {
+    nthreads = 1;
+  } else if (nthreads > MAXTHREADS) {
+    nthreads = MAXTHREADS;
+  }
+  for (total = 6; total <= 2 * n; total++) {
+    for (m = 3; m <= n; m++) {
+      for (o = 3; o <= n; o++) {
+	if (m + o == total - 2 && tabs[m][o]) {
+	  free(tabs[m][o]->val);
+	  free(tabs[m][o]);
+	  tabs[m][o] = NULL;
+	}
+      }
+    }
+    for (m = 3; m <= total / 2; m++) {
+      if ((o = total - m) <= n && m + o <= t->npoints) {
+	solve(m, o);
+      }
+    }
+  }
+  return 0;
+}
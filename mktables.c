@@ -0,0 +1,751 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Build the adjacency, mill and coordinate tables for every board and
+ * write them to standard output as C source, so that the game itself
+ * starts with read-only tables and never has to link a board together.
+ * The boards are read from the descriptions named on the command line,
+ * one per game in the order of the variant numbers in nmm.h.
+ *
+ * A description is a text file of lines, each a keyword and its
+ * arguments; `#' starts a comment. The keywords are
+ *
+ *   name n		what the game is called on the command line
+ *   title t		and in full, to the end of the line
+ *   pieces n		pieces each player places in phase 1
+ *   fly n		pieces left, at most, for a player to jump; 0
+ *			if players never jump
+ *   moveinhand yes	pieces may slide in phase 1 as well
+ *   points p ...	points, numbered in the order given
+ *   line p q ...	a straight line joining each point to the next
+ *   mill p q r		a line of three points that makes a mill
+ *
+ * Points are named by column and row, `a1' at the bottom left, and
+ * the direction of each line follows from the names.
+ */
+
+#include <ctype.h>
+#include <err.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+#define SPACE " \t\r\n"
+
+static struct topology topo_[NVARIANTS];
+
+/* The description being read, for complaints */
+static const char *path;
+static int lineno;
+
+__BEGIN_DECLS
+__dead void	 bad(const char *, ...);
+int	 findpoint(const struct topology *, const char *);
+void	 addpoint(struct topology *, const char *);
+void	 join(struct topology *, const int, const int, const int);
+int	 adjoin(struct topology *, const int, const int);
+void	 addline(struct topology *, char *, const int);
+int	 number(const char *, const int, const int);
+void	 pointmills(struct topology *);
+void	 readboard(struct topology *, const char *);
+int	 automorphism(const struct topology *, const signed char *);
+int	 ringswap(const struct topology *, const int);
+int	 symmetry(const struct topology *, const int, const int, const int,
+		  signed char *);
+void	 findsyms(struct topology *);
+void	 emitmasks(const char *, const bitboard *, const int);
+void	 emit(const int);
+uint64_t random64(void);
+void	 emitkeys(const char *, const int);
+void	 emitzobrist(void);
+void	 emitbinom(void);
+void	 emitkernels(void);
+int	 main(int, char **);
+__END_DECLS
+
+/* ********************************
+ * Reading the boards
+ * ******************************** */
+
+/*
+ * Complain about the line of the description being read, or about
+ * the whole of it once it's read, and give up
+ */
+void
+bad(const char *fmt, ...)
+{
+  va_list ap;
+
+  if (lineno) {
+    fprintf(stderr, "mktables: %s:%d: ", path, lineno);
+  } else {
+    fprintf(stderr, "mktables: %s: ", path);
+  }
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fprintf(stderr, "\n");
+  exit(EXIT_FAILURE);
+}
+
+/*
+ * The point named s, which must have been given already
+ */
+int
+findpoint(const struct topology *t, const char *s)
+{
+  int p;
+
+  for (p = 0; p < t->npoints && strcmp(s, t->names[p]) != 0; p++)
+    ;
+  if (p == t->npoints) {
+    bad("no point %s", s);
+  }
+  return p;
+}
+
+/*
+ * Add the next point, named s
+ */
+void
+addpoint(struct topology *t, const char *s)
+{
+  int c = s[0] - 'a';
+  int r = s[1] - '1';
+  int p = t->npoints;
+
+  if (strlen(s) != 2 || c < 0 || c >= MAXSIDE || r < 0 || r >= MAXSIDE) {
+    bad("%s is not a point from a1 to %c%d", s, 'a' + MAXSIDE - 1, MAXSIDE);
+  }
+  if (t->at[c][r] != NOPOINT) {
+    bad("%s is given twice", s);
+  }
+  if (p == MAXPOINTS) {
+    bad("more than %d points", MAXPOINTS);
+  }
+  t->at[c][r] = p;
+  memcpy(t->names[p], s, 3);
+  t->npoints++;
+  t->all = BIT(t->npoints) - 1;
+  if (t->side < c + 1) {
+    t->side = c + 1;
+  }
+  if (t->side < r + 1) {
+    t->side = r + 1;
+  }
+}
+
+/*
+ * Connect two points, with a in direction dir of b. dir must be one
+ * of NORTH, WEST, NE, NW.
+ */
+void
+join(struct topology *t, const int dir, const int a, const int b)
+{
+  if ((t->nbr[b][dir] != NOPOINT && t->nbr[b][dir] != a) ||
+      (t->nbr[a][dir + 1] != NOPOINT && t->nbr[a][dir + 1] != b)) {
+    bad("line %s-%s meets another going the same way",
+	t->names[a], t->names[b]);
+  }
+  t->nbr[b][dir] = a;
+  t->nbr[a][dir + 1] = b;
+  t->adj[a] |= BIT(b);
+  t->adj[b] |= BIT(a);
+}
+
+/*
+ * Join points p and q, which must lie in a line across, up or
+ * diagonally. Returns the direction from p to q.
+ */
+int
+adjoin(struct topology *t, const int p, const int q)
+{
+  int dc = t->names[q][0] - t->names[p][0];
+  int dr = t->names[q][1] - t->names[p][1];
+  int dir, a;
+
+  if (p == q || (dc && dr && dc != dr && dc != -dr)) {
+    bad("no straight line from %s to %s", t->names[p], t->names[q]);
+  }
+  if (!dr) {
+    /* The left-hand point is a */
+    dir = WEST;
+    a = dc > 0 ? p : q;
+  } else {
+    /* The upper point is a */
+    dir = !dc ? NORTH : dc == dr ? NE : NW;
+    a = dr > 0 ? q : p;
+    t->diagonals |= dc != 0;
+  }
+  join(t, dir, a, a == p ? q : p);
+  return a == q ? dir : dir + 1;
+}
+
+/*
+ * Join the points named in s one to the next, all in the same
+ * direction. A mill must be three long.
+ */
+void
+addline(struct topology *t, char *s, const int mill)
+{
+  char *w;
+  int n, p, q, dir, first = NOPOINT;
+  bitboard line = 0;
+
+  for (n = 0, q = NOPOINT; (w = strtok(s, SPACE)); n++, s = NULL) {
+    p = q;
+    q = findpoint(t, w);
+    line |= BIT(q);
+    if (p == NOPOINT) {
+      continue;
+    }
+    dir = adjoin(t, p, q);
+    if (first == NOPOINT) {
+      first = dir;
+    } else if (dir != first) {
+      bad("line turns at %s", t->names[p]);
+    }
+  }
+  if (n < 2) {
+    bad("a line needs two points or more");
+  }
+  if (mill) {
+    if (n != 3) {
+      bad("a mill needs three points");
+    }
+    if (t->nmills == MAXMILLS) {
+      bad("more than %d mills", MAXMILLS);
+    }
+    t->mills[t->nmills++] = line;
+  }
+}
+
+/*
+ * The whole number s, which must be from lo to hi
+ */
+int
+number(const char *s, const int lo, const int hi)
+{
+  char *end;
+  long n;
+
+  errno = 0;
+  n = strtol(s, &end, 10);
+  if (!*s || *end || errno || n < lo || n > hi) {
+    bad("expected a number from %d to %d", lo, hi);
+  }
+  return n;
+}
+
+/*
+ * List the mills through each point, by their other two points
+ */
+void
+pointmills(struct topology *t)
+{
+  int p, i;
+
+  for (p = 0; p < t->npoints; p++) {
+    t->npmills[p] = 0;
+    for (i = 0; i < t->nmills; i++) {
+      if (!(t->mills[i] & BIT(p))) {
+	continue;
+      }
+      if (t->npmills[p] == MAXPMILLS) {
+	bad("more than %d mills through %s", MAXPMILLS, t->names[p]);
+      }
+      t->pmills[p][t->npmills[p]++] = t->mills[i] & ~BIT(p);
+    }
+  }
+}
+
+/*
+ * Read topology t from the description in file
+ */
+void
+readboard(struct topology *t, const char *file)
+{
+  char buf[256], key[16], *arg, *end;
+  FILE *f;
+  int n;
+
+  memset(t, 0, sizeof(*t));
+  memset(t->nbr, NOPOINT, sizeof(t->nbr));
+  memset(t->at, NOPOINT, sizeof(t->at));
+  t->npieces = -1;
+  t->fly = -1;
+  if (!(f = fopen(file, "r"))) {
+    err(1, "%s", file);
+  }
+  path = file;
+  for (lineno = 1; fgets(buf, sizeof(buf), f); lineno++) {
+    if ((arg = strchr(buf, '#'))) {
+      *arg = '\0';
+    }
+    if (sscanf(buf, "%15s %n", key, &n) != 1) {
+      continue;
+    }
+    /* The argument is the rest of the line, without trailing space */
+    arg = buf + n;
+    for (end = arg + strlen(arg); end > arg && strchr(SPACE, end[-1]); end--)
+      ;
+    *end = '\0';
+    if (strcmp(key, "name") == 0) {
+      for (end = arg; isalnum((unsigned char)*end); end++)
+	;
+      if (!*arg || *end || strlen(arg) >= sizeof(t->name)) {
+	bad("a name is one word of %zu letters or fewer",
+	    sizeof(t->name) - 1);
+      }
+      strcpy(t->name, arg);
+    } else if (strcmp(key, "title") == 0) {
+      if (strlen(arg) >= sizeof(t->title) || strpbrk(arg, "\"\\")) {
+	bad("a title is %zu characters or fewer, without quotes",
+	    sizeof(t->title) - 1);
+      }
+      strcpy(t->title, arg);
+    } else if (strcmp(key, "pieces") == 0) {
+      t->npieces = number(arg, 3, MAXHAND);
+    } else if (strcmp(key, "fly") == 0) {
+      t->fly = number(arg, 0, MAXHAND);
+    } else if (strcmp(key, "moveinhand") == 0) {
+      if (strcmp(arg, "yes") != 0 && strcmp(arg, "no") != 0) {
+	bad("expected yes or no");
+      }
+      t->moveinhand = strcmp(arg, "yes") == 0;
+    } else if (strcmp(key, "points") == 0) {
+      for (arg = strtok(arg, SPACE); arg; arg = strtok(NULL, SPACE)) {
+	addpoint(t, arg);
+      }
+    } else if (strcmp(key, "line") == 0 || strcmp(key, "mill") == 0) {
+      addline(t, arg, key[0] == 'm');
+    } else {
+      bad("unknown keyword %s", key);
+    }
+  }
+  if (ferror(f)) {
+    err(1, "%s", file);
+  }
+  fclose(f);
+  lineno = 0;
+  if (!t->name[0] || !t->title[0] || t->npieces < 0 || t->fly < 0 ||
+      !t->nmills) {
+    bad("a board needs a name, title, pieces, fly and mills");
+  }
+  pointmills(t);
+  findsyms(t);
+}
+
+/* ********************************
+ * Symmetries
+ * ******************************** */
+
+/*
+ * Does the permutation perm take lines to lines and mills to mills?
+ */
+int
+automorphism(const struct topology *t, const signed char *perm)
+{
+  bitboard b;
+  int p, i, j;
+
+  for (p = 0; p < t->npoints; p++) {
+    if (perm[p] == NOPOINT) {
+      return 0;
+    }
+  }
+  for (p = 0; p < t->npoints; p++) {
+    for (b = t->adj[p]; b; b &= b - 1) {
+      if (!(t->adj[perm[p]] & BIT(perm[lowbit(b)]))) {
+	return 0;
+      }
+    }
+  }
+  for (i = 0; i < t->nmills; i++) {
+    for (b = 0, p = 0; p < t->npoints; p++) {
+      if (t->mills[i] & BIT(p)) {
+	b |= BIT(perm[p]);
+      }
+    }
+    for (j = 0; j < t->nmills && t->mills[j] != b; j++)
+      ;
+    if (j == t->nmills) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Where swapping the inner and outer rings takes column or row c:
+ * each half of the side is turned end to end, and the middle stays.
+ */
+int
+ringswap(const struct topology *t, const int c)
+{
+  int m = (t->side - 1) / 2;
+
+  if (c < m) {
+    return m - 1 - c;
+  } else if (c >= t->side - m) {
+    return 2 * t->side - m - 1 - c;
+  }
+  return c;
+}
+
+/*
+ * Fill in perm with where each point goes when the rings are swapped
+ * if w, the board is reflected if f, and then turned k quarters
+ * clockwise. Returns whether that is a symmetry of the board.
+ */
+int
+symmetry(const struct topology *t, const int w, const int f, const int k,
+	 signed char *perm)
+{
+  int p, c, r, x, y, i, tmp;
+
+  for (c = 0; c < t->side; c++) {
+    for (r = 0; r < t->side; r++) {
+      if ((p = t->at[c][r]) == NOPOINT) {
+	continue;
+      }
+      x = w ? ringswap(t, c) : c;
+      y = w ? ringswap(t, r) : r;
+      if (f) {
+	x = t->side - 1 - x;
+      }
+      for (i = 0; i < k; i++) {
+	/* A quarter turn clockwise */
+	tmp = x;
+	x = y;
+	y = t->side - 1 - tmp;
+      }
+      perm[p] = t->at[x][y];
+    }
+  }
+  return automorphism(t, perm);
+}
+
+/*
+ * Find the board's symmetries: the quarter turns and reflections of
+ * the square, and on the boards of more than one ring, the same again
+ * with the inner and outer rings swapped. Symmetry 0 is the identity.
+ * Also tabulate each one applied to every byte of a bitboard.
+ */
+void
+findsyms(struct topology *t)
+{
+  signed char perm[MAXPOINTS];
+  int k, f, w, s, p, i, v;
+
+  t->nsyms = 0;
+  for (w = 0; w < 2; w++) {
+    if (w && (ringswap(t, 0) == 0 || !symmetry(t, 1, 0, 0, perm))) {
+      /* There's one ring, or the rings don't match */
+      break;
+    }
+    for (f = 0; f < 2; f++) {
+      for (k = 0; k < 4; k++) {
+	if (!symmetry(t, w, f, k, perm)) {
+	  bad("%s isn't symmetric", t->name);
+	}
+	memcpy(t->sym[t->nsyms++], perm, sizeof(perm));
+      }
+    }
+  }
+  for (s = 0; s < t->nsyms; s++) {
+    for (i = 0; i < t->nsyms; i++) {
+      for (p = 0; p < t->npoints && t->sym[i][t->sym[s][p]] == p; p++)
+	;
+      if (p == t->npoints) {
+	t->syminv[s] = i;
+      }
+    }
+    for (i = 0; i < 3; i++) {
+      for (v = 0; v < 256; v++) {
+	t->symlut[s][i][v] = 0;
+	for (p = 0; p < 8; p++) {
+	  if (v & 1 << p && 8*i + p < t->npoints) {
+	    t->symlut[s][i][v] |= BIT(t->sym[s][8*i + p]);
+	  }
+	}
+      }
+    }
+  }
+}
+
+/*
+ * Print a brace-enclosed list of n masks, six to a line
+ */
+void
+emitmasks(const char *indent, const bitboard *m, const int n)
+{
+  int i;
+  printf("{");
+  for (i = 0; i < n; i++) {
+    if (n > 6 && i % 6 == 0) {
+      printf("\n%s  ", indent);
+    } else {
+      printf(" ");
+    }
+    printf("0x%06lx,", (unsigned long)m[i]);
+  }
+  printf(n > 6 ? "\n%s}" : " }", indent);
+}
+
+/*
+ * Print the initializer of one topology
+ */
+void
+emit(const int v)
+{
+  const struct topology *t = &topo_[v];
+  int p, d, c, r, s, i;
+
+  printf("  [%d] = {\n", v);
+  printf("    .name = \"%s\",\n", t->name);
+  printf("    .title = \"%s\",\n", t->title);
+  printf("    .npoints = %d,\n", t->npoints);
+  printf("    .npieces = %d,\n", t->npieces);
+  printf("    .fly = %d,\n", t->fly);
+  printf("    .moveinhand = %d,\n", t->moveinhand);
+  printf("    .diagonals = %d,\n", t->diagonals);
+  printf("    .nmills = %d,\n", t->nmills);
+  printf("    .all = 0x%06lx,\n", (unsigned long)t->all);
+  printf("    .nbr = {\n");
+  for (p = 0; p < t->npoints; p++) {
+    printf("      {");
+    for (d = MINDIR; d <= MAXDIR; d++) {
+      printf(d == MINDIR ? "%2d" : ", %2d", t->nbr[p][d]);
+    }
+    printf(" },\t/* %s */\n", t->names[p]);
+  }
+  printf("    },\n");
+  printf("    .adj = ");
+  emitmasks("    ", t->adj, t->npoints);
+  printf(",\n    .mills = ");
+  emitmasks("    ", t->mills, t->nmills);
+  printf(",\n    .npmills = {");
+  for (p = 0; p < t->npoints; p++) {
+    printf(p ? ", %d" : " %d", t->npmills[p]);
+  }
+  printf(" },\n");
+  printf("    .pmills = {\n");
+  for (p = 0; p < t->npoints; p++) {
+    printf("      ");
+    emitmasks("      ", t->pmills[p], t->npmills[p]);
+    printf(",\n");
+  }
+  printf("    },\n");
+  printf("    .side = %d,\n", t->side);
+  printf("    .at = {\n");
+  for (c = 0; c < t->side; c++) {
+    printf("      {");
+    for (r = 0; r < t->side; r++) {
+      printf(r ? ", %2d" : " %2d", t->at[c][r]);
+    }
+    printf(" },\n");
+  }
+  printf("    },\n");
+  printf("    .names = {");
+  for (p = 0; p < t->npoints; p++) {
+    printf(p % 12 ? " \"%s\"," : "\n      \"%s\",", t->names[p]);
+  }
+  printf("\n    },\n");
+  printf("    .nsyms = %d,\n", t->nsyms);
+  printf("    .sym = {\n");
+  for (s = 0; s < t->nsyms; s++) {
+    printf("      {");
+    for (p = 0; p < t->npoints; p++) {
+      printf(p ? ", %d" : " %d", t->sym[s][p]);
+    }
+    printf(" },\n");
+  }
+  printf("    },\n");
+  printf("    .syminv = {");
+  for (s = 0; s < t->nsyms; s++) {
+    printf(s ? ", %d" : " %d", t->syminv[s]);
+  }
+  printf(" },\n");
+  printf("    .symlut = {\n");
+  for (s = 0; s < t->nsyms; s++) {
+    printf("      {\n");
+    for (i = 0; i < 3; i++) {
+      printf("\t");
+      emitmasks("\t", t->symlut[s][i], 256);
+      printf(",\n");
+    }
+    printf("      },\n");
+  }
+  printf("    },\n");
+  printf("  },\n");
+}
+
+/*
+ * splitmix64, seeded with a constant so every build hashes alike
+ */
+uint64_t
+random64(void)
+{
+  static uint64_t x = 0x4e696e65204d656eULL;
+  uint64_t z;
+
+  z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/*
+ * Print a brace-enclosed list of n fresh random keys, three to a line
+ */
+void
+emitkeys(const char *indent, const int n)
+{
+  int i;
+  printf("{");
+  for (i = 0; i < n; i++) {
+    if (i % 3 == 0) {
+      printf("\n%s  ", indent);
+    } else {
+      printf(" ");
+    }
+    printf("0x%016llxULL,", (unsigned long long)random64());
+  }
+  printf("\n%s}", indent);
+}
+
+/*
+ * Print the Zobrist keys
+ */
+void
+emitzobrist(void)
+{
+  printf("const struct zobrist zobrist = {\n");
+  printf("  .piece = {\n    ");
+  emitkeys("    ", MAXPOINTS);
+  printf(",\n    ");
+  emitkeys("    ", MAXPOINTS);
+  printf(",\n  },\n  .inhand = {\n    ");
+  emitkeys("    ", MAXHAND + 1);
+  printf(",\n    ");
+  emitkeys("    ", MAXHAND + 1);
+  printf(",\n  },\n");
+  printf("  .side = 0x%016llxULL,\n", (unsigned long long)random64());
+  printf("  .remove = 0x%016llxULL,\n", (unsigned long long)random64());
+  printf("};\n");
+}
+
+/*
+ * Binomial coefficients, for numbering sets of points
+ */
+void
+emitbinom(void)
+{
+  uint32_t b[MAXPOINTS + 1][MAXPOINTS + 1] = { { 0 } };
+  int n, k;
+
+  printf("const uint32_t binom[MAXPOINTS + 1][MAXPOINTS + 1] = {\n");
+  for (n = 0; n <= MAXPOINTS; n++) {
+    b[n][0] = 1;
+    printf("  { 1");
+    for (k = 1; k <= MAXPOINTS; k++) {
+      b[n][k] = n ? b[n - 1][k - 1] + b[n - 1][k] : 0;
+      printf(", %lu", (unsigned long)b[n][k]);
+    }
+    printf(" },\n");
+  }
+  printf("};\n");
+}
+
+/*
+ * Compile the rules in kernel.h once for each game, after the tables
+ * they use, and list each game's copies
+ */
+void
+emitkernels(void)
+{
+  static const char *const fn[] = {
+    "coordpoint", "closesmill", "millpieces", "removable", "winner",
+    "genmoves", "setphase", "makemove"
+  };
+  size_t i;
+  int v;
+
+  for (v = 0; v < NVARIANTS; v++) {
+    printf("#define VARIANT %d\n", v);
+    printf("#define KNAME(f) f##_%s\n", topo_[v].name);
+    printf("#include \"kernel.h\"\n");
+    printf("#undef VARIANT\n");
+    printf("#undef KNAME\n\n");
+  }
+  printf("const struct kernel kernels[NVARIANTS] = {\n");
+  for (v = 0; v < NVARIANTS; v++) {
+    printf("  [%d] = {\n", v);
+    for (i = 0; i < sizeof(fn) / sizeof(fn[0]); i++) {
+      printf("    .%s = %s_%s,\n", fn[i], fn[i], topo_[v].name);
+    }
+    printf("  },\n");
+  }
+  printf("};\n");
+}
+
+int
+main(int argc, char **argv)
+{
+  int v, i;
+
+  if (argc != NVARIANTS + 1) {
+    fprintf(stderr, "usage: mktables board ... (%d of them)\n", NVARIANTS);
+    return EXIT_FAILURE;
+  }
+  for (v = 0; v < NVARIANTS; v++) {
+    readboard(&topo_[v], argv[v + 1]);
+    for (i = 0; i < v; i++) {
+      if (strcmp(topo_[i].name, topo_[v].name) == 0) {
+	bad("%s is the name of %s too", topo_[v].name, argv[i + 1]);
+      }
+    }
+  }
+  printf("/* Generated by mktables; do not edit. */\n\n");
+  printf("#include \"nmm.h\"\n\n");
+  printf("const struct topology topo[NVARIANTS] = {\n");
+  for (v = 0; v < NVARIANTS; v++) {
+    emit(v);
+  }
+  printf("};\n\n");
+  emitzobrist();
+  printf("\n");
+  emitbinom();
+  printf("\n");
+  emitkernels();
+  return ferror(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -34,39 +34,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/cdefs.h>
+#include <unistd.h>
 
-/*
- * __dead isn't defined everywhere; although it's typically installed
- * in sys/cdefs.h. The following is based off of OpenBSD's
- * sys/cdefs.h
- */
-#if !defined(__dead) && defined(__dead2)
-#define __dead	__dead2
-#elif !defined(__dead) && defined(__GNUC__) && !defined(__STRICT_ANSI__)
-#define __dead	__volatile
-#elif !defined(__dead) && !defined(__STRICT_ANSI__)
-#define __dead	__atribute__((__noreturn__))
-#elif !defined(__dead)
-#define __dead	/* NORETURN */
-#endif
+#include "nmm.h"
 
 #define VERSION "1.0"
 
-#define EMPTY 'E'
-#define WHITEC 'W'
-#define BLACKC 'B'
-#define WHITE 0
-#define BLACK 1
-#define NORTH 0
-#define SOUTH 1
-#define WEST 2
-#define EAST 3
-#define NE 4
-#define SW 5
-#define NW 6
-#define SE 7
-#define MINDIR NORTH
-#define MAXDIR SE
 #define NORTHC "n"
 #define EASTC "e"
 #define SOUTHC "s"
@@ -76,18 +49,13 @@
 #define SEC "se"
 #define SWC "sw"
 
-#define ROWS 3
-#define COLS 9
-
-#define NMM 4
-#define TMM 3
-#define TWMM 12
-
 #define sbrow 3         /* score box */
 #define sbcol 37
 #define brdrow 2        /* board     */
 #define brdcol 4
 #define legendsep 3     /* distance board<->legend */
+#define rowstep(t) (12 / ((t)->side - 1))	/* between rows of points */
+#define colstep(t) (18 / ((t)->side - 1))	/* and columns */
 #define msgrow 20       /* message box */
 #define msgcol 7
 #define promptcol 16
@@ -96,29 +64,54 @@
 #define helpcol 65
 #define helprow 0
 
-/* Board & game construction */
-typedef struct point {
-  char v; /* Value: what's currently here */
-  struct point* n[8]; /* Our neighbours, indexed by NORTH, SOUTH, WEST, EAST,
-			 NE, SW, NW, SE, see dirc below */
-} point;
+/*
+ * What the windows show, so that only what has changed since is drawn
+ */
+struct shown {
+  bitboard bb[2];	/* pieces on the board */
+  int phase;		/* and in the score box */
+  int pieces[2];
+  int state;
+  char msg[80 - msgcol];
+  int valid;		/* 0 until all of it has been drawn once */
+};
 
-typedef point* nboard[ROWS][COLS];
+/*
+ * What the player is being asked for
+ */
+enum inputmode {
+  AWAIT_PLACE,
+  AWAIT_SLIDE,		/* or to jump, with three pieces */
+  AWAIT_REMOVE,
+  GAME_OVER		/* whether to play again */
+};
 
-typedef struct game {
-  nboard board;
-  int state;
-  int pieces[2];
-  int totalpieces;
-  int phase;
-  int type;
-} game;
+/*
+ * The line being typed at the prompt
+ */
+struct prompt {
+  char buf[6];
+  int len;
+  int quitc;		/* q was typed at the start of the line */
+  int help;		/* the instructions are showing */
+};
 
 typedef struct scrgame {
   struct game *game;
   WINDOW *score_w;
   WINDOW *board_w;
   WINDOW *msg_w;
+  int computer;		/* colour the computer plays, or NOCOLOUR */
+  int depth;		/* how hard the computer thinks */
+  double thinktime;
+  int nthreads;		/* how many threads it thinks with */
+  struct tt tt;
+  struct egdb *egdb;	/* endgame databases, or NULL */
+  struct book *book;	/* opening book, or NULL */
+  struct undostack undo;	/* moves to take back or redo */
+  struct shown shown;
+  enum inputmode mode;
+  struct prompt prompt;
 } scrgame;
 
 /* Let's make looking up directions -> indices easier */
@@ -131,60 +124,43 @@ static const struct strkey dirc[] = {
 };
 
 __BEGIN_DECLS
-int	 joinpts(const int, point *, point *);
-void	 joinns(point *, point *);
-void	 joinwe(point *, point *);
-void	 joinnesw(point *, point *);
-void	 joinnwse(point *, point *);
-void	 freepoint(point *);
 int	 dirtoindex(const char *);
-point	 makepoint(const char, point *, point *,
-		   point *, point *);
-void	 updatepoint(point *, const char, point *, point *,
-		     point *, point *);
-void	 init3board(nboard);
-void	 init9board(nboard);
-void	 init12board(nboard);
-void	 initgame(game *, const int);
 void	 initall(scrgame *, const int);
 /*	 Rendering functions */
 WINDOW	*create_scorebox(const game *);
-void	 update_scorebox(WINDOW *, const game *);
+void	 update_scorebox(scrgame *);
 WINDOW	*create_board(const game *);
-WINDOW	*create_3board(const game *);
-WINDOW	*create_9board(const game *);
-WINDOW	*create_12board(const game *);
-void	 update_board(WINDOW *, const game *);
-void	 update_3board(WINDOW *, const game *);
-void	 update_9board(WINDOW *, const game *);
+void	 drawline(WINDOW *, const int, const int, const int, const int);
+void	 pointyx(const game *, const int, int *, int *);
+void	 update_board(scrgame *);
 WINDOW	*create_msgbox(void);
-void	 update_msgbox(WINDOW *, const char *);
-char	*getgname(const game *);
+void	 update_msgbox(scrgame *, const char *);
+void	 render(scrgame *);
+const char *getgname(const game *);
 void	 full_redraw(scrgame *);
-void	 printinstrs(scrgame *);
-int	 gameend(const scrgame *);
+void	 printinstrs(void);
 __dead void	 quit(void);
 /*	 During game */
-int	 surrounded(const game *);
-int	 inmill(const point *);
-point	*mill_handler(scrgame *, char *, int);
-char	 statechar(const game *);
 int	 validcoords(const game *, const char *);
-int	 valid3coords(const char *);
-int	 valid9coords(const char *);
 int      checkdir(const char *);
-char    *getinput(scrgame *, char *, const int);
-char	*getmove(scrgame *, char *, int);
-point	*getpoint(const game *, const char *);
-point	*get3point(const game *, const char *);
-point	*get9point(const game *, const char *);
-point	*placepiece(const scrgame *, const char *);
-point	*movepiece(point *, const char *);
-point   *jumppiece(point *, game *, const char *);
-point   *removepiece(game *, point *);
-point	*phaseone(scrgame *);
-point	*phasetwothree(scrgame *);
+int	 tryplace(scrgame *, const char *);
+int	 tryslide(scrgame *, const int, const char *);
+int	 tryjump(scrgame *, const int, const char *);
+int	 undokeys(scrgame *, const char *);
+void	 computermove(scrgame *);
+enum inputmode nextmode(const game *);
+void	 setmode(scrgame *);
+int	 linelength(const scrgame *);
+void	 clearprompt(scrgame *);
+void	 enterplace(scrgame *, const char *);
+void	 enterslide(scrgame *, const char *);
+void	 enterremove(scrgame *, const char *);
+void	 enterline(scrgame *);
+void	 feedkey(scrgame *, const int);
+int	 nextkey(scrgame *);
 char	*lower(char *);
+int	 sides(const char *, double *);
+__dead void	 usage(const char *);
 int	 main(int, char **);
 __END_DECLS
 
@@ -195,10 +171,10 @@ const char *const instructions[] = {
   "reduce the opponent to 2 pieces. Gameplay is split into three phases.\n",
   "\n",
   "Phase 1. Users alternatingly place a piece on the board, until each\n",
-  "  player has placed 3/9/12 pieces. The location is selected by entering\n",
+  "  player has placed all of theirs. The location is selected by entering\n",
   "  its coordinates, e.g. `a1' or `g7'. A mill can be formed by aligning\n",
   "  three pieces along a dashed line, at which point an opponent's piece\n",
-  "  is removed. This piece is selected by entering its coordinates.\n",
+  "  is removed by entering its coordinates, written `xa1' in records.\n",
   "Phase 2. Users alternatingly slide one of their pieces along dashed line\n",
   "  to an adjacent empty position. The piece is selected by entering its\n",
   "  coordinates and its direction is chosen from n s e w ne nw se sw, for\n",
@@ -207,12 +183,11 @@ const char *const instructions[] = {
   "  and pieces removed as in phase 1. Phase 2 continues until a player\n",
   "  only has 3 pieces remaining or can make no move.\n",
   "Phase 3. The player with three pieces may move a piece to any empty\n",
-  "  location, e.g. `a1g7' moves the piece at a1 to location g7. The player\n",
-  "  with more than three pieces moves as in phase 2. The first player to\n",
-  "  reduce the opponent to two pieces wins.\n",
-  "\n",
-  "Press `?' to display these instructions, and `q' to quit.\n",
-  "\n",
+  "  location, e.g. `a1g7' moves the piece at a1 to g7 (not in Six Men's\n",
+  "  Morris). The player with more than three pieces moves as in phase 2.\n",
+  "  In Lasker Morris pieces may move in phase 1; press return to place.\n",
+  "Press `?' to display these instructions, and `q' to quit. Press `u' to\n",
+  "take back a move, and `r' to play it again.\n",
   "Press any key to continue...",
   NULL
 };
@@ -221,83 +196,6 @@ const char *const instructions[] = {
  * Board and game creation
  * ************************** */
 
-/*
- * Connect two points, with p1 in direction L1 of p2
- */
-int
-joinpts(const int L1, /*@null@*/ point *p1, /*@null@*/ point *p2)
-{
-  /* Check L1 % 2 == 0 to make sure L1 == NORTH,WEST,NE,NW */
-  if (MINDIR <= L1 && L1 <= MAXDIR && L1 % 2 == 0) {
-    if (p1) {
-      p1->n[L1+1] = p2;
-      freepoint(p1);
-    }
-    if (p2) {
-      p2->n[L1] = p1;
-      freepoint(p2);
-    }
-    return 1;
-  }
-  return 0;
-}
-
-/*
- * Join the north point n to the south point s
- */
-void
-joinns(/*@null@*/ point *n, /*@null@*/ point *s)
-{
-  joinpts(NORTH, n, s);
-}
-
-/*
- * Join the west point w to the east point e
- */
-void
-joinwe(/*@null@*/ point *w, /*@null@*/ point *e)
-{
-  joinpts(WEST, w, e);
-}
-
-/*
- * Join the north east point ne to the south west point sw
- */
-void
-joinnesw(/*@null@*/ point *ne, /*@null@*/ point *sw)
-{
-  joinpts(NE, ne, sw);
-}
-
-/*
- * Join the north west point nw to the south east point se
- */
-void
-joinnwse(/*@null@*/ point *nw, /*@null@*/ point *se)
-{
-  joinpts(NW, nw, se);
-}
-
-/*
- * Free the memory allocated to a point if it has no neighbours
- */
-void
-freepoint(point *p)
-{
-  int i, joined = 0;
-  for (i = 0; i <= MAXDIR; i++) {
-    if (p->n[i]) {
-      joined = 1;
-      break;
-    }
-  }
-  if (!joined) {
-    /* p has no neighbours */
-    /* FIXME: Why does this crash with modified chunk-pointer? */
-    /* free(p); */
-  }
-}
-
 /*
  * Converts a direction to a neighbour index
  */
@@ -314,131 +212,6 @@ dirtoindex(const char *dir)
   return -1;
 }
 
-/*
- * Given a label and four main neighbours, create a point
- */
-point
-makepoint(const char v, /*@null@*/ point *n, /*@null@*/ point *s,
-	  /*@null@*/ point *e, /*@null@*/ point *w)
-{
-  point temp;
-  updatepoint(&temp, v, n, s, e, w);
-  return temp;
-}
-
-/*
- * Update the value and four main neighbours of a point p
- */
-void
-updatepoint(point *p, const char v, point *n, point *s,
-	    point *w, point *e)
-{
-  p->v = v;
-  joinns(p, s);
-  joinns(n, p);
-  joinwe(w, p);
-  joinwe(p, e);
-}
-
-/*
- * Create the board for Three Man Morris
- */
-void
-init3board(nboard b)
-{
-  int r = 0;
-  /* Initialize everything to an empty grid */
-  for (r = 0; r < 3; r++) {
-    updatepoint(b[r][0], EMPTY, NULL, NULL, NULL, NULL);
-    updatepoint(b[r][1], EMPTY, NULL, NULL, b[r][0], NULL);
-    updatepoint(b[r][2], EMPTY, NULL, NULL, b[r][1], NULL);
-    b[r][3] = NULL;
-  }
-  for (r = 0; r < 2; r++) {
-    joinns(b[r][0], b[r+1][0]);
-    joinns(b[r][1], b[r+1][1]);
-    joinns(b[r][2], b[r+1][2]);
-  }
-}
-
-/*
- * Create the board for Nine Man Morris
- */
-void
-init9board(nboard b)
-{
-  int r = 0;
-  /* Initialize everything to an empty grid */
-  for (r = 0; r < 3; r++) {
-    updatepoint(b[r][0], EMPTY, NULL, NULL, b[r][7], NULL); /* Top mid   */
-    updatepoint(b[r][1], EMPTY, NULL, NULL, b[r][0], NULL); /* Top right */
-    updatepoint(b[r][2], EMPTY, b[r][1], NULL, NULL, NULL); /* Mid right */
-    updatepoint(b[r][3], EMPTY, b[r][2], NULL, NULL, NULL); /* Bot right */
-    updatepoint(b[r][4], EMPTY, NULL, NULL, NULL, b[r][3]); /* Bot mid   */
-    updatepoint(b[r][5], EMPTY, NULL, NULL, NULL, b[r][4]); /* Bot left  */
-    updatepoint(b[r][6], EMPTY, NULL, b[r][5], NULL, NULL); /* Mid left  */
-    updatepoint(b[r][7], EMPTY, NULL, b[r][6], NULL, NULL); /* Top left  */
-    b[r][8] = NULL;
-  }
-  for (r = 0; r < 2; r++) {
-    printw("\n\n%d\n\n\n", r);
-    joinns(b[r][0], b[r+1][0]); /* Top vertical line */
-    joinns(b[r+1][4], b[r][4]); /* Bot vertical line */
-    joinwe(b[r][6], b[r+1][6]); /* Left horiz line   */
-    joinwe(b[r+1][2], b[r][2]); /* Right horiz line  */
-  }
-}
-
-/*
- * Create the board for Twelve Man Morris
- */
-void
-init12board(nboard b)
-{
-  int r = 0;
-  init9board(b);
-  for (r = 0; r < 2; r++) {
-    /* Top right */
-    joinnesw(b[r][1], b[r+1][1]);
-    /* Bottom right */
-    joinnwse(b[r+1][3], b[r][3]);
-    /* Bottom left */
-    joinnesw(b[r+1][5], b[r][5]);
-    /* Top left */
-    joinnwse(b[r][7], b[r+1][7]);
-  }
-}
-
-/*
- * Initialize a game with the appropriate boards, reset scores, etc.
- */
-void
-initgame(game *g, const int type)
-{
-  switch (type)
-  {
-  case TMM:
-    init3board(g->board);
-    g->type = TMM;
-    break;
-
-  case TWMM:
-    init12board(g->board);
-    g->type = TWMM;
-    break;
-
-  default:
-    init9board(g->board);
-    g->type = NMM;
-  }
-  /* We'll assume that, as in chess, black moves first */
-  g->state = BLACK;
-  g->phase = 1;
-  g->totalpieces = 0;
-  g->pieces[WHITE] = 0;
-  g->pieces[BLACK] = 0;
-}
-
 /*
  * Initialize the board and all of the windors in a scrgame
  */
@@ -446,7 +219,16 @@ void
 initall(scrgame *sg, const int type)
 {
   initgame(sg->game, type);
+  sg->undo.n = sg->undo.top = 0;
+  sg->mode = nextmode(sg->game);
+  sg->prompt.help = 0;
+  /* The last game's end is still showing */
+  sg->shown.valid = 0;
+  if (sg->computer != NOCOLOUR) {
+    ttclear(&sg->tt);
+  }
   full_redraw(sg);
+  clearprompt(sg);
 }
 
 /* ********************
@@ -468,211 +250,137 @@ create_scorebox(const game *g)
   /* Uncomment the following for the curses box, but I prefer the
      "rustic" boxes drawn with pipes, hyphens and plusses */
   /* box(local_win, 0, 0); */
-  switch (g->type)
-  {
-  case TMM:
-    mvwprintw(local_win, 1, 2, "Three Man Morris");
-    break;
-  case TWMM:
-    mvwprintw(local_win, 1, 2, "Twelve Man Morris");
-    break;
-  default:
-    mvwprintw(local_win, 1, 2, "Nine Man Morris");
-    break;
-  }
-  /* update will call a refresh for us */
-  update_scorebox(local_win, g);
+  mvwprintw(local_win, 1, 2, "%s", TOPO(g)->title);
+  mvwaddstr(local_win, promptrow, promptcol, "          |");
   return local_win;
 }
 
 /*
- * Update the score, phase, and current player
+ * Update the score, phase, and current player, where they've changed
  */
 void
-update_scorebox(WINDOW *w, const game *g)
-{
-  mvwprintw(w, 3, 2, "Phase %d", g->phase);
-  mvwprintw(w, 4, 2, "White pieces: %d", g->pieces[WHITE]);
-  mvwprintw(w, 5, 2, "Black pieces: %d", g->pieces[BLACK]);
-  if (g->state == BLACK) {
-    mvwprintw(w, 7, 2, "Black's move: ");
-  } else {
-    mvwprintw(w, 7, 2, "White's move: ");
-  }
-  mvwaddstr(w, promptrow, promptcol, "          |");
-  wrefresh(w);
-}
-
-/*
- * Determine the type of board to draw and draw it
- */
-WINDOW *
-create_board(const game *g)
+update_scorebox(scrgame *sg)
 {
-  switch (g->type)
-  {
-  case TMM:
-    return create_3board(g);
+  const game *g = sg->game;
+  struct shown *sh = &sg->shown;
+  WINDOW *w = sg->score_w;
 
-  case TWMM:
-    return create_12board(g);
-
-  default:
-    return create_9board(g);
+  if (!sh->valid || sh->phase != g->phase) {
+    mvwprintw(w, 3, 2, "Phase %d", g->phase);
   }
-}
-
-/*
- * Draw board for Three Man Morris
- */
-WINDOW *
-create_3board(const game *g)
-{
-  WINDOW *local_win;
-  int r = 0;
-  char c = 'a';
-
-  local_win = newwin(13 + legendsep, 21 + legendsep, brdrow, brdcol);
-
-  /* Draw the legend */
-  for (r = 0; r < 3; r++) {
-    mvwprintw(local_win, 6*r, 0, "%d", 3-r);
+  if (!sh->valid || sh->pieces[WHITE] != g->pieces[WHITE] ||
+      sh->pieces[BLACK] != g->pieces[BLACK]) {
+    mvwprintw(w, 4, 2, "White pieces: %-2d", g->pieces[WHITE]);
+    mvwprintw(w, 5, 2, "Black pieces: %-2d", g->pieces[BLACK]);
   }
-  c = 'a';
-  for (r = 0; r < 21; r += 9) {
-    mvwaddch(local_win, 14, legendsep + r, c++);
-  }
-  /* Draw the board lines */
-  for (r = 0; r < 3; r++) {
-    mvwhline(local_win, 6*r, legendsep, '-', 18);
-    mvwvline(local_win, 1, legendsep + 9*r, '|', 11);
+  if (!sh->valid || sh->state != g->state) {
+    if (g->state == BLACK) {
+      mvwprintw(w, 7, 2, "Black's move: ");
+    } else {
+      mvwprintw(w, 7, 2, "White's move: ");
+    }
   }
-
-  update_3board(local_win, g);
-  return local_win;
+  sh->phase = g->phase;
+  sh->pieces[WHITE] = g->pieces[WHITE];
+  sh->pieces[BLACK] = g->pieces[BLACK];
+  sh->state = g->state;
 }
 
 /*
- * Draw board for Nine Man Morris
+ * Draw the board of game g: the legend, and the lines between
+ * neighbouring points. The points are left to update_board.
  */
 WINDOW *
-create_9board(const game *g)
+create_board(const game *g)
 {
+  const struct topology *t = TOPO(g);
   WINDOW *local_win;
-  int r = 0;
-  char c = 'a';
+  int p, q, d, i, y0, x0, y1, x1;
 
   local_win = newwin(13 + legendsep, 21 + legendsep, brdrow, brdcol);
 
-  /* Draw the legend */
-  for (r = 0; r < 7; r++) {
-    mvwprintw(local_win, 2*r, 0, "%d", 7-r);
+  /* Draw the legend, level with the rows and columns of points */
+  for (i = 0; i < t->side; i++) {
+    mvwprintw(local_win, (t->side - 1 - i) * rowstep(t), 0, "%d", i + 1);
+    mvwaddch(local_win, 14, legendsep + i * colstep(t), 'a' + i);
   }
-  c = 'a';
-  for (r = 0; r < 21; r += 3) {
-    mvwaddch(local_win, 14, legendsep + r, c++);
-  }
-
-  /* Draw the board lines */
-  for (r = 0; r < 3; r++) {
-    /* Top line */
-    mvwhline(local_win, 2*r, legendsep + 3*r, '-', 18 - 6*r);
-    /* Left line */
-    mvwvline(local_win, 2*r, legendsep + 3*r, '|', 13 - 4*r);
-    /* Bottom line */
-    mvwhline(local_win, 12 - 2*r, legendsep + 3*r, '-', 18 - 6*r);
-    /* Right line */
-    mvwvline(local_win, 2*r, 18 + legendsep - 3*r, '|', 13 - 4*r);
+  /* Draw the board lines, each from the point below or to the right */
+  for (p = 0; p < t->npoints; p++) {
+    for (d = MINDIR; d <= MAXDIR; d += 2) {
+      if ((q = t->nbr[p][d]) == NOPOINT) {
+	continue;
+      }
+      pointyx(g, p, &y0, &x0);
+      pointyx(g, q, &y1, &x1);
+      drawline(local_win, y0, x0, y1, x1);
+    }
   }
-  /* TV crossline */
-  mvwvline(local_win, 1, legendsep + 9, '|', 3);
-  /* LH crossline */
-  mvwhline(local_win, 6, legendsep + 1, '-', 5);
-  /* BV crossline */
-  mvwvline(local_win, 9, legendsep + 9, '|', 3);
-  /* RH crossline */
-  mvwhline(local_win, 6, legendsep + 13, '-', 5);
-
-  update_9board(local_win, g);
   return local_win;
 }
 
 /*
- * Draw board for Twelve Man Morris
+ * Draw a line in w from the point at y0, x0 to the one at y1, x1, up
+ * to but not over either
  */
-WINDOW *
-create_12board(const game *g)
+void
+drawline(WINDOW *w, const int y0, const int x0, const int y1, const int x1)
 {
-  WINDOW *local_win;
-  int r = 0;
-  local_win = create_9board(g);
-  /* Draw the diagonal lines */
-  for (r = 0; r < 2; r++) {
-    /* Top left */
-    mvwaddch(local_win, 2*r + 1, legendsep + 3*r + 2, '\\');
-    /* Top right */
-    mvwaddch(local_win, 2*r + 1, legendsep + 16 - 3*r, '/');
-    /* Bottom left */
-    mvwaddch(local_win, 11 - 2*r, legendsep + 3*r + 2, '/');
-    /* Bottom right */
-    mvwaddch(local_win, 11 - 2*r, legendsep + 16 - 3*r, '\\');
+  int dy = y1 - y0;
+  int dx = x1 - x0;
+  int n = abs(dy);
+  int i, x;
+
+  if (dy == 0) {
+    mvwhline(w, y0, (x0 < x1 ? x0 : x1) + 1, '-', abs(dx) - 1);
+  } else if (dx == 0) {
+    mvwvline(w, (y0 < y1 ? y0 : y1) + 1, x0, '|', n - 1);
+  } else {
+    /* A diagonal takes a character a row. Where it falls between two
+       columns, lean towards the middle of the board. */
+    for (i = 1; i < n; i++) {
+      x = n * x0 + i * dx;
+      x = x < n * (legendsep + 9) ? (x + n - 1) / n : x / n;
+      mvwaddch(w, y0 + i * dy / n, x, (dx > 0) == (dy > 0) ? '\\' : '/');
+    }
   }
-  wrefresh(local_win);
-  return local_win;
 }
 
 /*
- * Select the correct function to redraw points
+ * Where point p is drawn in the board window: the rows and columns
+ * are spread evenly over the same space on every board.
  */
 void
-update_board(WINDOW *w, const game *g)
+pointyx(const game *g, const int p, int *y, int *x)
 {
-  switch (g->type)
-  {
-  case TMM:
-    update_3board(w, g);
-    break;
+  const struct topology *t = TOPO(g);
 
-  case TWMM:
-  case NMM:
-  default:
-    update_9board(w, g);
-  }
+  *y = (t->side - 1 - (t->names[p][1] - '1')) * rowstep(t);
+  *x = legendsep + (t->names[p][0] - 'a') * colstep(t);
 }
 
 /*
- * Redraw points for Three Man Morris
+ * Redraw the points whose pieces have changed
  */
 void
-update_3board(WINDOW *w, const game *g)
+update_board(scrgame *sg)
 {
-  int r = 0;
-  for (r = 0; r < 3; r++) {
-    mvwaddch(w, 6*r, legendsep, g->board[r][0]->v);
-    mvwaddch(w, 6*r, legendsep + 9, g->board[r][1]->v);
-    mvwaddch(w, 6*r, legendsep + 18, g->board[r][2]->v);
-  }
-  wrefresh(w);
-}
+  const game *g = sg->game;
+  struct shown *sh = &sg->shown;
+  bitboard changed;
+  int p, y, x;
 
-/*
- * Redraw points for Nine and Twelve Man Morris
- */
-void
-update_9board(WINDOW *w, const game *g)
-{
-  int r = 0;
-  for (r = 0; r < 3; r++) {
-    mvwaddch(w, 2*r, legendsep + 9, g->board[r][0]->v);
-    mvwaddch(w, 2*r, legendsep + 18 - 3*r, g->board[r][1]->v);
-    mvwaddch(w, 6, legendsep + 18 - 3*r, g->board[r][2]->v);
-    mvwaddch(w, 12-2*r, legendsep + 18 - 3*r, g->board[r][3]->v);
-    mvwaddch(w, 12-2*r, legendsep + 9, g->board[r][4]->v);
-    mvwaddch(w, 12-2*r, legendsep + 3*r, g->board[r][5]->v);
-    mvwaddch(w, 6, legendsep + 3*r, g->board[r][6]->v);
-    mvwaddch(w, 2*r, legendsep + 3*r, g->board[r][7]->v);
+  if (sh->valid) {
+    changed = (g->bb[WHITE] ^ sh->bb[WHITE]) | (g->bb[BLACK] ^ sh->bb[BLACK]);
+  } else {
+    changed = TOPO(g)->all;
   }
-  wrefresh(w);
+  for (; changed; changed &= changed - 1) {
+    p = lowbit(changed);
+    pointyx(g, p, &y, &x);
+    mvwaddch(sg->board_w, y, x, pointchar(g, p));
+  }
+  sh->bb[WHITE] = g->bb[WHITE];
+  sh->bb[BLACK] = g->bb[BLACK];
 }
 
 /*
@@ -685,40 +393,53 @@ create_msgbox(void)
 }
 
 /*
- * Change message displayed in window
+ * Change message displayed in window. Like the other updates, it only
+ * changes the window; render puts it on the screen.
  */
 void
-update_msgbox(WINDOW *w, const char *msg)
+update_msgbox(scrgame *sg, const char *msg)
 {
-  werase(w);
-  mvwaddstr(w, 0, 0, msg);
-  wrefresh(w);
+  struct shown *sh = &sg->shown;
+
+  if (!sh->valid || strncmp(sh->msg, msg, sizeof(sh->msg) - 1) != 0) {
+    werase(sg->msg_w);
+    mvwaddstr(sg->msg_w, 0, 0, msg);
+    snprintf(sh->msg, sizeof(sh->msg), "%s", msg);
+  }
 }
 
-char *
+/*
+ * Bring the windows up to date with the game and put them on the
+ * screen, in one go. Only what has changed since is drawn, and it all
+ * goes out with the one doupdate.
+ */
+void
+render(scrgame *sg)
+{
+  update_scorebox(sg);
+  update_board(sg);
+  sg->shown.valid = 1;
+  wnoutrefresh(sg->board_w);
+  wnoutrefresh(sg->msg_w);
+  /* Last, so that the cursor is left in the prompt */
+  wnoutrefresh(sg->score_w);
+  doupdate();
+}
+
+const char *
 getgname(const game *g)
 {
-  switch (g->type)
-  {
-  case TMM:
-    return "tmm";
-    
-  case TWMM:
-    return "twmm";
-    
-  case NMM:
-  default:
-    return "nmm";
-  }
+  return TOPO(g)->name;
 }
 
 /*
- * Completely redraw *everything*
+ * Completely redraw *everything*. The windows are made the first time,
+ * and kept after that.
  */
 void
 full_redraw(scrgame *sg)
 {
-  static char *name = NULL;
+  static const char *name = NULL;
   static size_t vers_len;
   static const char *helpstr = "? : help";
   static const size_t helplen = 8;
@@ -727,58 +448,37 @@ full_redraw(scrgame *sg)
   }
   /* 10 = strlen(" version ") */
   vers_len = strlen(name) + strlen(VERSION) + 10;
-  delwin(sg->board_w);
-  delwin(sg->score_w);
-  delwin(sg->msg_w);
-  clear();
+  if (!sg->board_w) {
+    sg->board_w = create_board(sg->game);
+    sg->score_w = create_scorebox(sg->game);
+    sg->msg_w = create_msgbox();
+    sg->shown.valid = 0;
+  }
+  werase(stdscr);
   /* We want the ends of the version string and of
    * helpstr to line up. */
   mvprintw(versrow, helpcol + helplen - vers_len,
 	   "%s version %s", name, VERSION);
-  mvprintw(helprow, helpcol, helpstr);
-  refresh();
-  sg->board_w = create_board(sg->game);
-  sg->score_w = create_scorebox(sg->game);
-  sg->msg_w = create_msgbox();
+  mvprintw(helprow, helpcol, "%s", helpstr);
+  wnoutrefresh(stdscr);
+  touchwin(sg->board_w);
+  touchwin(sg->score_w);
+  touchwin(sg->msg_w);
+  render(sg);
 }
 
 /*
- * Print instructions to screen and prompt to continue
+ * Print instructions to screen, over the game until the next key
  */
 void
-printinstrs(scrgame *sg)
+printinstrs(void)
 {
-  /* TODO: Factor out the refresh-everything part */
   const char *const *instr;
   clear();
   for (instr = instructions; *instr; instr++) {
     printw("%s", *instr);
   }
   refresh();
-  getch();
-  full_redraw(sg);
-}
-
-/*
- * Announce winner, prompt user to play again, non-zero if user wants
- * to.
- */
-int
-gameend(const scrgame *sg)
-{
-  char c;
-  if (sg->game->pieces[WHITE] < sg->game->pieces[BLACK]) {
-    update_msgbox(sg->msg_w,
-		  "Black wins! Play again?");
-  } else {
-    update_msgbox(sg->msg_w,
-		  "White wins! Play again?");
-  }
-  mvwprintw(sg->score_w, promptrow, 2, "Play again?:     ");
-  wrefresh(sg->score_w);
-  c = mvwgetch(sg->score_w, promptrow, promptcol);
-  c = tolower(c);
-  return (c == 'y');
 }
 
 /*
@@ -797,635 +497,456 @@ quit(void)
  * ******************************** */
 
 /*
- * Checks if the current player can slide to any adjacent position.
+ * Checks the validity of coordinates for a game
+ * Assumes coords are lower case and of length 2
  */
 int
-surrounded(const game *g)
+validcoords(const game *g, const char *coords)
 {
-  int r, c, n;
-  char currplayerch = statechar(g);
-  c = 0;
-  for (r = 0; g->board[r][c]; r++) {
-    for (c = 0; g->board[r][c]; c++) {
-      if (g->board[r][c]->v == currplayerch) {
-	for (n = MINDIR; n <= MAXDIR; n++) {
-	  if (g->board[r][c]->n[n] &&
-	      g->board[r][c]->n[n]->v == EMPTY) {
-	    return 0;
-	  }
-	}
-      }
-    }
-  }
-  return 1;
+  return coordpoint(g, coords) != NOPOINT;
 }
 
 /*
- * Is the point p in a mill?
+ * Checks the validity of a direction
  */
 int
-inmill(const point *p)
+checkdir(const char *dir)
 {
-  if (p->v == BLACKC || p->v == WHITEC) {
-    point *neighbours[8];
-    int counts[4] = {1, 1, 1, 1};
-    int i, dir = MINDIR;
-    for (dir = MINDIR; dir <= MAXDIR; dir++) {
-      neighbours[dir] = p->n[dir];
-    }
-
-    /* We should walk at most 2 steps in any direction */
+  if (isalpha(dir[0])) {
+    char d[3];
+    int i;
     for (i = 0; i < 2; i++) {
-      for (dir = MINDIR; dir <= MAXDIR; dir++) {
-	if (neighbours[dir] && neighbours[dir]->v == p->v) {
-	  /* Makes use of the fact that directions along the same axis
-	   * are 1 apart (e.g. SOUTH = NORTH + 1 = 1), and that
-	   * division truncates toward zero */
-	  counts[dir / 2]++;
-	  neighbours[dir] = neighbours[dir]->n[dir];
-	}
-      }
-    }
-    /* If we have three in a row along any axis, we're in a mill */
-    for (i = 0; i < 4; i++) {
-      if (counts[i] == 3) {
-	return 1;
-      }
+      d[i] = tolower(dir[0]);
     }
+    d[2] = '\0';
+    i = dirtoindex(d);
+    return (MINDIR <= i && i <= MAXDIR);
   }
-  /* If we're EMPTY, we're clearly not in a mill */
   return 0;
 }
 
 /*
- * Handle a mill by dealing with the removal of an opponent's piece.
- * Prompts the user for a piece to remove, checks its legality, and
- * removes it. Return the removed piece, recursing until a piece is
- * removed.
+ * Place a piece corresponding to the current player at the coordinates coords.
  */
-point *
-mill_handler(scrgame *sg, char *move, int count)
+int
+tryplace(scrgame *sg, const char *coords)
 {
-  point *p = NULL;
-
-  if (count == 0) {
-    update_msgbox(sg->msg_w,
-		  "You've formed a mill, enter opponent piece to remove.");
-  }
-  getmove(sg, move, 3);
-  if ((p = getpoint(sg->game, move))) {
-    if (p->v != statechar(sg->game) && p->v != EMPTY) {
-      if (inmill(p)) {
-	/* We can only break an opponent's mill if there are no other
-	   pieces to remove. We could keep a list of each player's
-	   pieces, but this implies the headache of always updating
-	   it. Alternatively, we can just iterate through at most 21
-	   points, until we find an opponent piece not in a mill, or
-	   nothing. */
-	int r = 0;
-	int c = 0;
-	int opp = 0;
-	if (sg->game->state == WHITE) {
-	  opp = BLACKC;
-	} else {
-	  opp = WHITEC;
-	}
-	for (r = 0; r < 3; r++) {
-	  for (c = 0; c < 7; c++) {
-	    if (sg->game->board[r][c]->v == opp && !inmill(sg->game->board[r][c])) {
-	      update_msgbox(sg->msg_w,
-			    "It is possible to remove a piece not in a mill; do so.");
-	      return mill_handler(sg, move, 1);
-	    }
-	  }
-	}
-	/* By this point, we've iterated through all of the opponent's
-	   pieces without encountering one not in a mill. Allow the
-	   desired piece to be removed. */
-      }
-      p->v = EMPTY;
-      /* Decrement the opponent's pieces */
-      sg->game->pieces[sg->game->state ^ BLACK]--;
+  int p;
+  if ((p = coordpoint(sg->game, coords)) != NOPOINT) {
+    if (pointchar(sg->game, p) != EMPTY) {
+      update_msgbox(sg, "That location is already occupied, please try again.");
+      return NOPOINT;
+    } else if (legalmove(sg->game, MOVE(PLACE, 0, p))) {
+      pushmove(&sg->undo, sg->game, MOVE(PLACE, 0, p));
       return p;
-    } else if (p->v == EMPTY) {
-      update_msgbox(sg->msg_w,
-		    "You tried clearing an empty position. Please try again.");
-      return mill_handler(sg, move, 1);
     } else {
-      update_msgbox(sg->msg_w,
-		    "You tried removing your own piece. Please try again.");
-      return mill_handler(sg, move, 1);
+      /* Where pieces slide in phase 1, one side may run out first */
+      update_msgbox(sg, "You have no pieces left to place.");
+      return NOPOINT;
     }
   } else {
-    update_msgbox(sg->msg_w, "Invalid coordinates. Please try again.");
-    return mill_handler(sg, move, 1);
+    update_msgbox(sg, "Invalid coordinates. Please try again.");
+    return NOPOINT;
   }
 }
 
-/*
- * Return the char corresponding to the current state
- */
-char
-statechar(const game *g)
-{
-  return g->state == WHITE ? WHITEC : BLACKC;
-}
 
 /*
- * Checks the validity of coordinates for a game
- * Assumes coords are lower case and of length 2
+ * Move a piece from p in direction dir
  */
 int
-validcoords(const game *g, const char *coords)
+tryslide(scrgame *sg, const int p, const char *dir)
 {
-  switch (g->type)
-  {
-  case TMM:
-    return valid3coords(coords);
-
-  case NMM:
-  case TWMM:
-  default:
-    return valid9coords(coords);
+  int to;
+  to = TOPO(sg->game)->nbr[p][dirtoindex(dir)];
+  if (to != NOPOINT && legalmove(sg->game, MOVE(SLIDE, p, to))) {
+    pushmove(&sg->undo, sg->game, MOVE(SLIDE, p, to));
+    return to;
   }
+  return NOPOINT;
 }
 
 /*
- * Checks the validity of coordinates for Three Man Morris
- * Assumes coords are lower case and of length 2
+ * Move point p to the given position
  */
 int
-valid3coords(const char *coords)
+tryjump(scrgame *sg, const int p, const char *position)
 {
-  return ('a' <= coords[0] && coords[0] <= 'c' &&
-	  '1' <= coords[1] && coords[1] <= '3');
+  int to = coordpoint(sg->game, position);
+  if (to != NOPOINT && legalmove(sg->game, MOVE(JUMP, p, to))) {
+    pushmove(&sg->undo, sg->game, MOVE(JUMP, p, to));
+    return to;
+  }
+  return NOPOINT;
 }
 
 /*
- * Checks the validity of coordinates for Nine, Twelve Man Morris
- * Assumes coords are lower case and of length 2
+ * If inp is `u', take back moves until it's a player's turn to move a
+ * piece again, skipping the computer's turns; if it's `r', play them
+ * again the same way. Returns non-zero if inp was either.
  */
 int
-valid9coords(const char *coords)
+undokeys(scrgame *sg, const char *inp)
 {
-  if (coords[0] < 'a' || 'g' < coords[0] || coords[1] < '0' || '7' < coords[1]) {
-    return 0;
-  }
-  switch (coords[0])
-  {
-  case 'a': case 'g':
-    return (coords[1] == '1' || coords[1] == '4' || coords[1] == '7');
-
-  case 'b': case 'f':
-    return (coords[1] == '2' || coords[1] == '4' || coords[1] == '6');
-
-  case 'c': case 'e':
-    return ('3' <= coords[1] && coords[1] <= '5');
-
-  case 'd':
-    return (coords[1] != '4');
+  int (*step)(struct undostack *, game *);
 
-  default:
-    /* UNREACHABLE */
+  if (strcmp(inp, "u") == 0) {
+    step = takeback;
+  } else if (strcmp(inp, "r") == 0) {
+    step = redo;
+  } else {
     return 0;
   }
+  if (step(&sg->undo, sg->game) == -1) {
+    update_msgbox(sg, step == takeback ?
+		  "There are no moves to take back." :
+		  "There are no moves to play again.");
+    return 1;
+  }
+  while ((sg->game->remove || sg->game->state == sg->computer) &&
+	 step(&sg->undo, sg->game) == 0) {
+    continue;
+  }
+  update_msgbox(sg, "");
+  return 1;
 }
 
 /*
- * Checks the validity of a direction
+ * Let the computer think up a move for the current player and play
+ * it, along with the removal if it forms a mill.
  */
-int
-checkdir(const char *dir)
+void
+computermove(scrgame *sg)
 {
-  if (isalpha(dir[0])) {
-    char d[3];
-    int i;
-    for (i = 0; i < 2; i++) {
-      d[i] = tolower(dir[0]);
+  static struct search s;
+  char msg[80], buf[MOVELEN];
+  size_t len;
+  move_t m;
+
+  update_msgbox(sg, "Thinking...");
+  render(sg);
+  len = snprintf(msg, sizeof(msg), "The computer played");
+  do {
+    initsearch(&s, sg->game);
+    s.maxdepth = sg->depth;
+    s.maxtime = sg->thinktime;
+    s.nthreads = sg->nthreads;
+    s.tt = &sg->tt;
+    s.egdb = sg->egdb;
+    s.book = sg->book;
+    if ((m = think(&s)) == NOMOVE) {
+      break;
     }
-    d[2] = '\0';
-    i = dirtoindex(d);
-    return (MINDIR <= i && i <= MAXDIR);
-  }
-  return 0;
+    len += snprintf(msg + len, sizeof(msg) - len, " %s",
+		    fmtmove(sg->game, m, buf));
+    pushmove(&sg->undo, sg->game, m);
+  } while (sg->game->remove);
+  update_msgbox(sg, msg);
 }
 
+/* ********************************
+ * The turn, one key at a time
+ * ******************************** */
+
 /*
- * Prompt user for input, handling backspace, return.
- * q twice at start of line: quit()
- * ? at start of line: printinstrs()
- * Otherwise, read up to length characters from sg->scorer_w into inp
- * Assume than inp always has room for at least '\0'
- * Recurse until no errors, return pointer to inp.
+ * What the player should be asked for in game g
  */
-char *
-getinput(scrgame *sg, char *inp, const int length)
+enum inputmode
+nextmode(const game *g)
 {
-  int l, ch, i, quitc;
-  quitc = 0;
-  /* Clear the prompt area */
-  mvwaddstr(sg->score_w, promptrow, promptcol, "          |");
-  wrefresh(sg->score_w);
-  for (l = 0; l < length - 1; l++) {
-    ch = mvwgetch(sg->score_w, promptrow, promptcol + l);
-    if (ch == 12) {
-      /* We were given a ^L */
-      full_redraw(sg);
-      update_msgbox(sg->msg_w, "");
-      for (i = 0; i < l; i++) {
-	mvwaddch(sg->score_w, promptrow, promptcol + i, inp[i]);
-      }
-      wrefresh(sg->score_w);
-      l--;
-      continue;
-    }
-    if (ch == '\b' || ch == KEY_BACKSPACE ||
-	ch == KEY_DC || ch == 127) {
-      /* We need to retake the current character; l++ will increase
-       * it, so counteract that with an l-- to remove the BACKSPACE. */
-      l--;
-      if (l >= 0) {
-	/* Erase the input char from the screen */
-	mvwaddch(sg->score_w, promptrow, promptcol + l, ' ');
-	/* And another l-- so that we overwrite the input char from
-	 * inp on the next iteration of this loop. */
-	l--;
-      } else {
-	/* We're at the start of the line, so there was no input char
-	 * to erase */
-      }
-      wrefresh(sg->score_w);
-      update_msgbox(sg->msg_w, "");
-      continue;
-    } else if (isalnum(ch)) {
-      if (ch == 'q' && l == 0) {
-	if (quitc) {
-	  quit();
-	} else {
-	  quitc = 1;
-	  update_msgbox(sg->msg_w, "Enter 'q' again to quit");
-	  mvwaddch(sg->score_w, promptrow, promptcol, ' ');
-	  l--;
-	}
-      } else {
-	inp[l] = (char) ch;
-	mvwaddch(sg->score_w, promptrow, promptcol + l, ch);
-      }
-      wrefresh(sg->score_w);
-    } else if (ch == '?' && l == 0) {
-      printinstrs(sg);
-      mvwaddch(sg->score_w, promptrow, promptcol, ' ');
-      l--;
-    } else if (ch == '\n') {
-      inp[l] = '\0';
-      break;
-    } else {
-      update_msgbox(sg->msg_w, "Unexpected non-ASCII input");
-      return getinput(sg, inp, length);
-    }
+  if (winner(g) != NOCOLOUR) {
+    return GAME_OVER;
+  } else if (g->remove) {
+    return AWAIT_REMOVE;
+  } else if (g->phase == 1) {
+    return AWAIT_PLACE;
   }
-  /* l <= length-1 */
-  inp[l] = '\0';
-  return inp;
+  return AWAIT_SLIDE;
 }
 
 /*
- * Prompts the user for a move with getinput, sanitizes it, and makes
- * the move. It stores the move in *move, you can specify the maximum
- * length l of the move to take, this should be at most the length of
- * move. If mill is less than three or more than five, move should
- * hold at least 5 characters. Returns pointer to the move.
+ * Catch sg->mode up with the game, saying what's wanted when it
+ * changes.
  */
-char *
-getmove(scrgame *sg, char *move, int l)
+void
+setmode(scrgame *sg)
 {
-  int length, pieces, index, twmm = 0;
-  /* Do we only have 3 pieces, i.e. are we in skipping mode? */
-  pieces = sg->game->pieces[(int) sg->game->state];
-  if (l < 3 || 5 < l) {
-    if (sg->game->type == TWMM) {
-      /* We need to add one to our length to make up for the
-       * possibility of ne/nw/se/sw over n/e/s/w */
-      twmm = 1;
-    }
-    switch (sg->game->phase)
-    {
-    case 1:
-      /* In piece placing mode */
-      length = 3;
-      break;
-
-    case 2:
-      /* Of form d3s or d3sw */
-      length = 4 + twmm;
-      break;
+  enum inputmode mode = nextmode(sg->game);
 
-    case 3:
-      if (pieces == 3) {
-	/* Of form d3a1 */
-	length = 5;
-      } else {
-	/* Of form d3s or d3sw */
-	length = 4 + twmm;
-      }
-      break;
-
-    default:
-      length = 0;
-      /* NOTREACHED */
-    }
-  } else {
-    length = l;
-  }
-  move = getinput(sg, move, length);
-  move = lower(move);
-  if (!validcoords(sg->game, move) ||
-      /* Check the length to make sure we're not in mill mode */
-      (pieces == 3 && length != 3 && !validcoords(sg->game, &move[2]))) {
-    update_msgbox(sg->msg_w, "Invalid coordinates");
-    return getmove(sg, move, length);
+  if (mode == sg->mode) {
+    return;
   }
-  /* If we'e in piece sliding stage. The length check makes sure we're
-     not in mill mode. */
-  if (sg->game->phase != 1 && pieces != 3 && length != 3) {
-    index = dirtoindex(&move[2]);
-    if (index == -1) {
-      update_msgbox(sg->msg_w, "Invalid direction");
-      return getmove(sg, move, length);
-    } else if (!(getpoint(sg->game, /* We already checked that move[2]
-				       is safe */
-			  move)->n[index])) {
-      update_msgbox(sg->msg_w, "Impossible to move in that direction");
-      return getmove(sg, move, length);
+  sg->mode = mode;
+  switch (mode)
+  {
+  case AWAIT_REMOVE:
+    update_msgbox(sg,
+		  "You've formed a mill, enter opponent piece to remove.");
+    break;
+
+  case GAME_OVER:
+    if (winner(sg->game) == BLACK) {
+      update_msgbox(sg,
+		    "Black wins! Play again?");
+    } else {
+      update_msgbox(sg,
+		    "White wins! Play again?");
     }
+    mvwprintw(sg->score_w, promptrow, 2, "Play again?:     ");
+    break;
+
+  default:
+    break;
   }
-  move[length - 1] = '\0';
-  return move;
+  clearprompt(sg);
 }
 
 /*
- * Given a coordinate array, retrieve the corresponding point by
- * calling the appropriate function.
+ * How many characters make up a whole line in the current mode, after
+ * which it's entered without waiting for return: `a1' to place or
+ * remove, `d3s' to slide, `d3sw' on boards with diagonals, `d3a1' to
+ * jump.
  */
-point *
-getpoint(const game *g, const char *coords)
+int
+linelength(const scrgame *sg)
 {
-  switch (g->type)
+  const game *g = sg->game;
+
+  switch (sg->mode)
   {
-  case TMM:
-    return get3point(g, coords);
+  case AWAIT_PLACE:
+    /* Where pieces slide in phase 1 too, return enters a placement */
+    if (!TOPO(g)->moveinhand) {
+      return 2;
+    }
+    /* FALLTHROUGH */
+  case AWAIT_SLIDE:
+    if (FLIES(g, g->state)) {
+      return 4;
+    }
+    /* The diagonals take an extra letter */
+    return TOPO(g)->diagonals ? 4 : 3;
+
+  case GAME_OVER:
+    return 1;
 
-  case NMM:
-  case TWMM:
   default:
-    return get9point(g, coords);
+    return 2;
   }
 }
 
 /*
- * Given a coordinate array, retrieve the corresponding point
+ * Forget the line being typed, and blank it at the prompt
  */
-point *
-get3point(const game *g, const char *coords)
+void
+clearprompt(scrgame *sg)
 {
-  int r;
-  if (validcoords(g, coords)) {
-    r = 2 + '1' - coords[1];
-    /* = 2 - (coords[0] - '1'); */
-    return g->board[r][coords[0] - 'a'];
-  }
-  return NULL;
+  sg->prompt.len = 0;
+  sg->prompt.quitc = 0;
+  mvwaddstr(sg->score_w, promptrow, promptcol, "          |");
 }
 
-
 /*
- * Given a coordinate array, retrieve the corresponding point
+ * Place a piece at the coordinates in line
  */
-point *
-get9point(const game *g, const char *coords)
+void
+enterplace(scrgame *sg, const char *line)
 {
-  int r, c = 0;
-  if (validcoords(g, coords)) {
-    switch (coords[1])
-    {
-    case '4':
-      if (coords[0] < 'd') {
-	r = coords[0] - 'a';
-	c = 6;
-      } else {
-	r = 'g' - coords[0];
-	c = 2;
-      }
-      break;
-
-    case '1': case '7':
-      r = 0;
-      break;
-
-    case '2': case '6':
-      r = 1;
-      break;
-
-    case '3': case '5':
-      r = 2;
-      break;
-
-    default:
-      /* NOTREACHED */
-      endwin();
-      errx(1, "Reached an unreachable branch in getpoint");
-      r = 0; /* Shut up gcc complaining that r may be
-		used unitialized */
-    }
-    if (coords[1] != '4') {
-      if (coords[0] < 'd') {
-	c = coords[1] < '4' ? 5 : 7;
-      } else if (coords[0] == 'd') {
-	c = coords[1] < '4' ? 4 : 0;
-      } else {
-	c = coords[1] < '4' ? 3 : 1;
-      }
-    }
-    return g->board[r][c];
+  if (tryplace(sg, line) != NOPOINT) {
+    update_msgbox(sg, "");
   }
-  return NULL;
 }
 
 /*
- * Place a piece corresponding to the current player at the coordinates coords.
+ * Slide the piece at the start of line in the direction after it, or
+ * jump it to the coordinates after it if the player has three left.
  */
-point *
-placepiece(const scrgame *sg, const char *coords)
+void
+enterslide(scrgame *sg, const char *line)
 {
-  point *p = NULL;
-  if ((p = getpoint(sg->game, coords))) {
-    if (p->v == EMPTY) {
-      p->v = statechar(sg->game);
-      return p;
-    } else {
-      update_msgbox(sg->msg_w, "That location is already occupied, please try again.");
-      return NULL;
+  const game *g = sg->game;
+  int p, dir;
+
+  if ((p = coordpoint(g, line)) == NOPOINT) {
+    update_msgbox(sg, "Invalid coordinates");
+    return;
+  }
+  if (pointchar(g, p) != statechar(g)) {
+    update_msgbox(sg, "Please move your own piece.");
+    return;
+  }
+  if (FLIES(g, g->state)) {
+    if (!validcoords(g, &line[2])) {
+      update_msgbox(sg, "Invalid coordinates");
+      return;
+    }
+    if (tryjump(sg, p, &line[2]) == NOPOINT) {
+      update_msgbox(sg,
+		    "That location is already occupied. Please try again");
+      return;
     }
   } else {
-    update_msgbox(sg->msg_w, "Invalid coordinates. Please try again.");
-    return NULL;
+    if ((dir = dirtoindex(&line[2])) == -1) {
+      update_msgbox(sg, "Invalid direction");
+      return;
+    }
+    if (TOPO(g)->nbr[p][dir] == NOPOINT) {
+      update_msgbox(sg, "Impossible to move in that direction");
+      return;
+    }
+    if (tryslide(sg, p, &line[2]) == NOPOINT) {
+      update_msgbox(sg,
+		    "That location is already occupied. Please try again");
+      return;
+    }
   }
+  update_msgbox(sg, "");
 }
 
-
 /*
- * Move a piece from p in direction dir
+ * Remove the opponent's piece at the coordinates in line, after a
+ * mill.
  */
-point *
-movepiece(point *p, const char *dir)
+void
+enterremove(scrgame *sg, const char *line)
 {
-  int index;
-  index = dirtoindex(dir);
-  if (p->n[index] && p->n[index]->v == EMPTY) {
-    p->n[index]->v = p->v;
-    p->v = EMPTY;
-    return p->n[index];
+  int p;
+
+  if ((p = coordpoint(sg->game, line)) == NOPOINT) {
+    update_msgbox(sg, "Invalid coordinates. Please try again.");
+  } else if (pointchar(sg->game, p) == EMPTY) {
+    update_msgbox(sg,
+		  "You tried clearing an empty position. Please try again.");
+  } else if (pointchar(sg->game, p) == statechar(sg->game)) {
+    update_msgbox(sg,
+		  "You tried removing your own piece. Please try again.");
+  } else if (!canremove(sg->game, p)) {
+    /* We can only break an opponent's mill if there are no other
+       pieces to remove. */
+    update_msgbox(sg,
+		  "It is possible to remove a piece not in a mill; do so.");
+  } else {
+    pushmove(&sg->undo, sg->game, MOVE(REMOVE, 0, p));
+    update_msgbox(sg, "");
   }
-  return NULL;
 }
 
 /*
- * Move point p to the given position
+ * Act on the line typed at the prompt, then start a new one
  */
-point *
-jumppiece(point *p, game *g, const char *position)
+void
+enterline(scrgame *sg)
 {
-  point *ptr = getpoint(g, position);
-  if (ptr && ptr->v == EMPTY) {
-    ptr->v = p->v;
-    p->v = EMPTY;
-    return ptr;
+  char *line = sg->prompt.buf;
+
+  line[sg->prompt.len] = '\0';
+  lower(line);
+  if (!undokeys(sg, line)) {
+    switch (sg->mode)
+    {
+    case AWAIT_PLACE:
+      if (TOPO(sg->game)->moveinhand && strlen(line) > 2) {
+	enterslide(sg, line);
+      } else {
+	enterplace(sg, line);
+      }
+      break;
+
+    case AWAIT_SLIDE:
+      enterslide(sg, line);
+      break;
+
+    case AWAIT_REMOVE:
+      enterremove(sg, line);
+      break;
+
+    default:
+      break;
+    }
   }
-  return NULL;
+  clearprompt(sg);
 }
 
 /*
- * Remove a point by setting it to empty and decrementing the piece
- * counts
+ * Feed one key from the player to the turn. Nothing waits here for
+ * the next: the line typed so far is kept in sg->prompt, and whatever
+ * it's for in sg->mode.
+ * q twice at start of line: quit()
+ * ? at start of line: printinstrs(), until the next key
+ * u or r at start of line: take back or play again
  */
-point *
-removepiece(game *g, point *p)
+void
+feedkey(scrgame *sg, const int ch)
 {
-  if (p && g) {
-    /* We let stupid people remove their own pieces */
-    if (p->v == BLACKC) {
-      g->pieces[BLACK]--;
-    } else if (p->v == WHITE) {
-      g->pieces[WHITE]--;
+  struct prompt *pr = &sg->prompt;
+
+  if (pr->help) {
+    /* Any key puts the game back */
+    pr->help = 0;
+    full_redraw(sg);
+    return;
+  }
+  if (sg->mode == GAME_OVER) {
+    if (tolower(ch) == 'y') {
+      initall(sg, sg->game->type);
     } else {
-      errno = ENOTSUP;
-      endwin();
-      errx(ENOTSUP, "Tried removing EMPTY. This should NEVER happen.");
+      quit();
     }
-    p->v = EMPTY;
-    return p;
+    return;
   }
-  return NULL;
-}
-
-/*
- * Phase one of the game
- * Returns NULL if one player is guaranteed to have less than 3 pieces
- * at the end of the phase, thus loosing.
- */
-point *
-phaseone(scrgame *sg)
-{
-  point *p = NULL;
-  char coords[4];
-  int maxrem = 0;
-  for (; sg->game->totalpieces < 2 * sg->game->type; sg->game->totalpieces++) {
-    getmove(sg, coords, 0);
-    if (!(p = placepiece(sg, coords))) {
-      sg->game->totalpieces--;
-      continue;
+  if (ch == 12) {
+    /* We were given a ^L: the windows still hold everything, so have
+       the next update repaint the screen from them */
+    clearok(curscr, TRUE);
+    update_msgbox(sg, "");
+  } else if (ch == '\b' || ch == KEY_BACKSPACE ||
+	     ch == KEY_DC || ch == 127) {
+    if (pr->len > 0) {
+      /* Erase the input char from the screen */
+      mvwaddch(sg->score_w, promptrow, promptcol + --pr->len, ' ');
     }
-    sg->game->pieces[sg->game->state]++;
-    if (inmill(p)) {
-      /* We should redraw the board now so that the player can see the
-	 piece he just played */
-      update_scorebox(sg->score_w, sg->game);
-      update_board(sg->board_w, sg->game);
-      update_msgbox(sg->msg_w, "");
-      mill_handler(sg, coords, 0);
+    update_msgbox(sg, "");
+  } else if ((ch == 'u' || ch == 'r') && pr->len == 0) {
+    pr->buf[pr->len++] = (char) ch;
+    enterline(sg);
+  } else if (ch == 'q' && pr->len == 0) {
+    if (pr->quitc) {
+      quit();
     }
-    sg->game->state ^= BLACK;
-    update_scorebox(sg->score_w, sg->game);
-    update_board(sg->board_w, sg->game);
-    update_msgbox(sg->msg_w, "");
-    maxrem = (2 * sg->game->type - sg->game->totalpieces) / 2;
-    if (sg->game->pieces[0] + maxrem < 3 ||
-	sg->game->pieces[1] + maxrem < 3) {
-      /* It's impossible for a player to place more than 3 pieces, abort */
-      return NULL;
+    pr->quitc = 1;
+    update_msgbox(sg, "Enter 'q' again to quit");
+  } else if (ch < 128 && isalnum(ch)) {
+    mvwaddch(sg->score_w, promptrow, promptcol + pr->len, ch);
+    pr->buf[pr->len++] = (char) ch;
+    if (pr->len == linelength(sg)) {
+      enterline(sg);
     }
-  }
-  if (sg->game->type == TMM) {
-    /* Three Man Morris doesn't have a phase 2 */
-    sg->game->phase = 3;
+  } else if (ch == '?' && pr->len == 0) {
+    printinstrs();
+    pr->help = 1;
+  } else if (ch == '\n' && pr->len > 0) {
+    enterline(sg);
+  } else if (ch == '\n') {
+    /* Nothing to enter */
   } else {
-    sg->game->phase = 2;
+    update_msgbox(sg, "Unexpected non-ASCII input");
+    clearprompt(sg);
   }
-  update_scorebox(sg->score_w, sg->game);
-  return p;
 }
 
 /*
- * Phases two and three of the game
+ * Bring the screen up to date and wait for the next key
  */
-point *
-phasetwothree(scrgame *sg)
+int
+nextkey(scrgame *sg)
 {
-  point *p = NULL;
-  char coords[6];
-  while (sg->game->pieces[WHITE] >= 3 && sg->game->pieces[BLACK] >= 3) {
-    if (sg->game->pieces[sg->game->state] > 3 && surrounded(sg->game)) {
-      update_scorebox(sg->score_w, sg->game);
-      update_board(sg->board_w, sg->game);
-      return NULL;
-    }
-    getmove(sg, coords, 0);
-    if (!(p = getpoint(sg->game, coords))) {
-      update_msgbox(sg->msg_w, "Something went wrong...");
-      continue;
-    }
-    if (p->v != statechar(sg->game)) {
-      update_msgbox(sg->msg_w, "Please move your own piece.");
-      continue;
-    }
-    if (sg->game->pieces[sg->game->state] == 3) {
-      if (!(p = jumppiece(p, sg->game, &coords[2]))) {
-	update_msgbox(sg->msg_w,
-		      "That location is already occupied. Please try again");
-	continue;
-      }
-    } else if (!(p = movepiece(p, &coords[2]))) {
-      update_msgbox(sg->msg_w,
-		    "That location is already occupied. Please try again");
-      continue;
-    }
-    if (inmill(p)) {
-      /* We should redraw the board now so that the player can see the
-	 piece he just played */
-      update_scorebox(sg->score_w, sg->game);
-      update_board(sg->board_w, sg->game);
-      update_msgbox(sg->msg_w, "");
-      mill_handler(sg, coords, 0);
-    }
-    sg->game->state ^= BLACK;
-    if (sg->game->pieces[BLACK] == 3 || sg->game->pieces[WHITE] == 3) {
-      sg->game->phase = 3;
-    }
-    update_scorebox(sg->score_w, sg->game);
-    update_board(sg->board_w, sg->game);
-    update_msgbox(sg->msg_w, "");
+  if (sg->prompt.help) {
+    /* The instructions are on stdscr, over the windows */
+    return getch();
   }
-  return p;
+  wmove(sg->score_w, promptrow, promptcol + sg->prompt.len);
+  render(sg);
+  return wgetch(sg->score_w);
 }
 
 /*
@@ -1442,6 +963,51 @@ lower(char *s)
   return s;
 }
 
+/*
+ * Parse a value for each side, given as `white,black' or as one value
+ * for both. Returns 0, or -1 if arg isn't of that form.
+ */
+int
+sides(const char *arg, double *v)
+{
+  char *end;
+
+  v[WHITE] = v[BLACK] = strtod(arg, &end);
+  if (end != arg && *end == ',') {
+    arg = end + 1;
+    v[BLACK] = strtod(arg, &end);
+  }
+  return (end == arg || *end) ? -1 : 0;
+}
+
+/*
+ * Explain the command line and exit
+ */
+__dead void
+usage(const char *bn)
+{
+  fprintf(stderr, "usage: %s [-b book] [-c colour] [-D depth] [-e directory] "
+	  "[-H mb] [-j threads]\n"
+	  "          [-t seconds]\n"
+	  "       %s -a [-D depth] [-e directory] [-f position] [-H mb] "
+	  "[-j threads]\n"
+	  "          [-n nodes] [-t seconds]\n"
+	  "       %s -B file [-D depth] [-e directory] [-H mb] [-j threads] "
+	  "[-n nodes]\n"
+	  "          [-t seconds]\n"
+	  "       %s -i [-b book] [-e directory] [-f position] [-H mb] "
+	  "[-j threads]\n"
+	  "       %s -L socket\n"
+	  "       %s -p depth [-d] [-f position] [-j threads]\n"
+	  "       %s -R file\n"
+	  "       %s -s games [-v] [-b book] [-D depth] [-e directory] "
+	  "[-f position] [-H mb]\n"
+	  "          [-j threads] [-l plies] [-r plies] [-S seed] "
+	  "[-t seconds]\n",
+	  bn, bn, bn, bn, bn, bn, bn, bn);
+  exit(EINVAL);
+}
+
 /*
  * The Big Cheese
  */
@@ -1449,7 +1015,21 @@ int
 main(int argc, char *argv[])
 {
   scrgame *sg;
-  int c;
+  struct search *s;
+  game start;
+  int c, type;
+  struct selfplay sp;
+  struct batch bt;
+  int analysis = 0, depth = -1, divide = 0, nthreads = ncpus();
+  int computer = NOCOLOUR, maxdepth, hashmb = -1, games = -1, verbose = 0;
+  int randomplies = 8, maxplies = 300, protocol = 0;
+  double depths[2] = { -1, -1 }, thinktime[2] = { -1, -1 };
+  unsigned long long seed = 0, maxnodes = 0;
+  const char *pos = NULL, *egdir = NULL, *bookpath = NULL, *batchpath = NULL;
+  const char *replaypath = NULL, *sockpath = NULL;
+  FILE *fp;
+  struct egdb *egdb = NULL;
+  struct book *book = NULL;
   char *bn = basename(argv[0]);
   if (!bn || errno) {
     /* basename can return a NULL pointer, causing a segfault on
@@ -1457,28 +1037,262 @@ main(int argc, char *argv[])
     errx(errno, "Something went wrong in determining the %s",
 	 "filename by which nmm was called.");
   }
-  if (argc != 1) {
-    errx(EINVAL, "%s doesn't take any arguments.", bn);
+  /* Play the game whose name we were called by the start of, or Nine
+     Man Morris */
+  for (type = 0; type < NVARIANTS; type++) {
+    if (strncmp(topo[type].name, bn, strlen(topo[type].name)) == 0) {
+      break;
+    }
   }
-  if ((sg = malloc(sizeof(*sg)))) {
-    if ((sg->game = malloc(sizeof(*sg->game)))) {
-      point *board;
-      if ((board = calloc(ROWS * COLS, sizeof(*board)))) {
-	int r;
-	for (r = 0; r < ROWS; r++) {
-	  for (c = 0; c < COLS; c++) {
-	    sg->game->board[r][c] = board++;
-	  }
-	}
+  if (type == NVARIANTS) {
+    type = NMM;
+  }
+  while ((c = getopt(argc, argv, "aB:b:c:D:de:f:H:ij:L:l:n:p:R:r:S:s:t:v")) != -1) {
+    switch (c)
+    {
+    case 'a':
+      analysis = 1;
+      break;
+
+    case 'B':
+      batchpath = optarg;
+      break;
+
+    case 'b':
+      bookpath = optarg;
+      break;
+
+    case 'c':
+      if (tolower((unsigned char)optarg[0]) == 'w') {
+	computer = WHITE;
+      } else if (tolower((unsigned char)optarg[0]) == 'b') {
+	computer = BLACK;
       } else {
-	errx(errno, "Unable to allocate memory for the board");
+	usage(bn);
       }
-    } else {
+      break;
+
+    case 'D':
+      if (sides(optarg, depths) == -1) {
+	usage(bn);
+      }
+      break;
+
+    case 'd':
+      divide = 1;
+      break;
+
+    case 'e':
+      egdir = optarg;
+      break;
+
+    case 'f':
+      pos = optarg;
+      break;
+
+    case 'H':
+      if ((hashmb = atoi(optarg)) < 1) {
+	errx(EINVAL, "Hash table size must be at least 1 MB");
+      }
+      break;
+
+    case 'i':
+      protocol = 1;
+      break;
+
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+
+    case 'L':
+      sockpath = optarg;
+      break;
+
+    case 'l':
+      if ((maxplies = atoi(optarg)) < 1) {
+	errx(EINVAL, "Games must be allowed at least one move");
+      }
+      break;
+
+    case 'n':
+      if ((maxnodes = strtoull(optarg, NULL, 0)) == 0) {
+	errx(EINVAL, "The node limit must be at least 1");
+      }
+      break;
+
+    case 'p':
+      depth = atoi(optarg);
+      break;
+
+    case 'R':
+      replaypath = optarg;
+      break;
+
+    case 'r':
+      randomplies = atoi(optarg);
+      break;
+
+    case 'S':
+      seed = strtoull(optarg, NULL, 0);
+      break;
+
+    case 's':
+      if ((games = atoi(optarg)) < 1) {
+	errx(EINVAL, "Self-play needs at least one game");
+      }
+      break;
+
+    case 't':
+      if (sides(optarg, thinktime) == -1) {
+	usage(bn);
+      }
+      break;
+
+    case 'v':
+      verbose = 1;
+      break;
+
+    default:
+      usage(bn);
+    }
+  }
+  if (argc != optind ||
+      analysis + protocol + (depth >= 0) + (games > 0) + !!batchpath +
+      !!replaypath + !!sockpath > 1 ||
+      (!analysis && !protocol && depth < 0 && games < 0 && pos) ||
+      (depth < 0 && divide) || (games < 0 && verbose) ||
+      (bookpath && (analysis || depth >= 0 || batchpath || replaypath ||
+		    sockpath)) ||
+      (maxnodes && !analysis && !batchpath)) {
+    usage(bn);
+  }
+  if (sockpath) {
+    runserver(sockpath, type);
+    return 0;
+  }
+  if (replaypath) {
+    /* Only the program name says which game to expect */
+    if (strcmp(replaypath, "-") == 0) {
+      fp = stdin;
+    } else if (!(fp = fopen(replaypath, "r"))) {
+      err(errno, "Unable to open %s", replaypath);
+    }
+    return runreplay(fp, stdout, type) ? 1 : 0;
+  }
+  initgame(&start, type);
+  if (pos && parsepos(&start, pos) == -1) {
+    errx(EINVAL, "Invalid position: %s", pos);
+  }
+  if (depth >= 0) {
+    runperft(&start, depth, divide, nthreads);
+    return 0;
+  }
+  if (protocol) {
+    /* Databases are opened for whichever game we're asked to play */
+    runprotocol(&start, nthreads, hashmb < 0 ? 16 : hashmb, egdir,
+		bookpath);
+    return 0;
+  }
+  if (egdir && !(egdb = egopen(egdir, type))) {
+    err(errno, "Unable to open the endgame databases in %s", egdir);
+  }
+  if (bookpath && !(book = bookopen(bookpath, type))) {
+    err(errno, "Unable to open the opening book %s", bookpath);
+  }
+  if (games > 0) {
+    /* Unless told otherwise, play quick games to a fixed depth */
+    if (depths[WHITE] < 0) {
+      depths[WHITE] = depths[BLACK] = thinktime[WHITE] < 0 ? 3 : MAXPLY - 1;
+    }
+    sp.start = start;
+    sp.ngames = games;
+    sp.nthreads = nthreads;
+    sp.randomplies = randomplies;
+    sp.maxplies = maxplies;
+    sp.seed = seed;
+    sp.hashmb = hashmb < 0 ? 1 : hashmb;
+    sp.verbose = verbose;
+    for (c = WHITE; c <= BLACK; c++) {
+      if (depths[c] < 0 || MAXPLY - 1 < depths[c]) {
+	errx(EINVAL, "Search depth must be between 0 and %d", MAXPLY - 1);
+      }
+      sp.side[c].depth = depths[c];
+      sp.side[c].maxtime = thinktime[c] < 0 ? 0 : thinktime[c];
+    }
+    sp.egdb = egdb;
+    sp.book = book;
+    runselfplay(&sp);
+    return 0;
+  }
+  if (batchpath) {
+    if (strcmp(batchpath, "-") == 0) {
+      bt.in = stdin;
+    } else if (!(bt.in = fopen(batchpath, "r"))) {
+      err(errno, "Unable to open %s", batchpath);
+    }
+    /* Unless told otherwise, search every position to a fixed depth */
+    if (depths[WHITE] < 0) {
+      depths[WHITE] = thinktime[WHITE] < 0 && !maxnodes ? 6 : MAXPLY - 1;
+    }
+    if (depths[WHITE] < 1 || MAXPLY - 1 < depths[WHITE]) {
+      errx(EINVAL, "Search depth must be between 1 and %d", MAXPLY - 1);
+    }
+    bt.out = stdout;
+    bt.maxdepth = depths[WHITE];
+    bt.maxnodes = maxnodes;
+    bt.maxtime = thinktime[WHITE] < 0 ? 0 : thinktime[WHITE];
+    bt.nthreads = nthreads;
+    bt.hashmb = hashmb < 0 ? 1 : hashmb;
+    bt.egdb = egdb;
+    bt.egtype = type;
+    runbatch(&bt);
+    return 0;
+  }
+  /* Only self-play tells the sides apart */
+  maxdepth = depths[WHITE] < 0 ? MAXPLY - 1 : depths[WHITE];
+  if (maxdepth < 1 || MAXPLY - 1 < maxdepth) {
+    errx(EINVAL, "Search depth must be between 1 and %d", MAXPLY - 1);
+  }
+  if (thinktime[WHITE] < 0) {
+    thinktime[WHITE] = 1.0;
+  }
+  if (hashmb < 0) {
+    hashmb = 16;
+  }
+  if (analysis) {
+    if (!(s = malloc(sizeof(*s)))) {
+      err(errno, "Unable to allocate the search");
+    }
+    initsearch(s, &start);
+    s->maxdepth = maxdepth;
+    s->maxtime = thinktime[WHITE];
+    s->maxnodes = maxnodes;
+    s->nthreads = nthreads;
+    s->egdb = egdb;
+    if (!(s->tt = malloc(sizeof(*s->tt))) || ttinit(s->tt, hashmb) == -1) {
+      errx(ENOMEM, "Unable to allocate the hash table");
+    }
+    analyse(s);
+    return 0;
+  }
+  if ((sg = malloc(sizeof(*sg)))) {
+    if (!(sg->game = malloc(sizeof(*sg->game)))) {
       errx(errno, "Unable to allocate memory for the game");
     }
+    sg->score_w = sg->board_w = sg->msg_w = NULL;
+    sg->computer = computer;
+    sg->depth = maxdepth;
+    sg->thinktime = thinktime[WHITE];
+    sg->nthreads = nthreads;
+    sg->egdb = egdb;
+    sg->book = book;
+    if (computer != NOCOLOUR && ttinit(&sg->tt, hashmb) == -1) {
+      errx(ENOMEM, "Unable to allocate the hash table");
+    }
   } else {
     errx(errno, "Unable to allocate memory");
   }
+  *sg->game = start;
   initscr();
   cbreak();
   keypad(stdscr, TRUE);
@@ -1488,28 +1302,21 @@ main(int argc, char *argv[])
   c = getch();
   c = tolower(c);
   if (c == 'y') {
-    printinstrs(sg);
+    printinstrs();
+    getch();
   }
   clear();
   noecho();
   refresh();
-  if (strncmp("tmm", bn, 3) == 0) {
-    c = TMM;
-  } else if (strncmp("twmm", bn, 4) == 0) {
-    c = TWMM;
-  } else {
-    c = NMM;
-  }
+  initall(sg, type);
+  /* The computer takes its turns here, and the player's one key at a
+     time, until they quit */
   for (;;) {
-    initall(sg, c);
-    refresh();
-    phaseone(sg);
-    phasetwothree(sg);
-    if (!gameend(sg)) {
-      break;
+    setmode(sg);
+    if (sg->mode != GAME_OVER && sg->game->state == sg->computer) {
+      computermove(sg);
+    } else {
+      feedkey(sg, nextkey(sg));
     }
   }
-  refresh();
-  endwin();
-  return 0;
 }
@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NMM_H
+#define NMM_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * __dead isn't defined everywhere; although it's typically installed
+ * in sys/cdefs.h. The following is based off of OpenBSD's
+ * sys/cdefs.h
+ */
+#if !defined(__dead) && defined(__dead2)
+#define __dead	__dead2
+#elif !defined(__dead) && defined(__GNUC__) && !defined(__STRICT_ANSI__)
+#define __dead	__volatile
+#elif !defined(__dead) && !defined(__STRICT_ANSI__)
+#define __dead	__atribute__((__noreturn__))
+#elif !defined(__dead)
+#define __dead	/* NORETURN */
+#endif
+
+#define EMPTY 'E'
+#define WHITEC 'W'
+#define BLACKC 'B'
+#define WHITE 0
+#define BLACK 1
+#define NORTH 0
+#define SOUTH 1
+#define WEST 2
+#define EAST 3
+#define NE 4
+#define SW 5
+#define NW 6
+#define SE 7
+#define MINDIR NORTH
+#define MAXDIR SE
+
+/* In the order the Makefile gives their boards to mktables */
+#define TMM 0
+#define NMM 1
+#define TWMM 2
+#define SMM 3
+#define LASKER 4
+#define NVARIANTS 5
+
+#define MAXPOINTS 24    /* points on the largest board */
+#define MAXSIDE 7       /* columns and rows on the largest board */
+#define MAXMILLS 20     /* mill lines on the largest board */
+#define MAXPMILLS 3     /* mill lines through any one point */
+#define MAXHAND 12      /* most pieces a player places in phase 1 */
+#define MAXSYMS 16      /* symmetries of the most symmetric board */
+#define NOPOINT (-1)
+#define NOCOLOUR (-1)
+
+/*
+ * Boards are stored as bitboards: bit p is set if point p is
+ * occupied. Points are numbered in the order the board's description
+ * in boards/ lists them: ring by ring, outermost first, and clockwise
+ * from the top middle within a ring, so that point r*8 + c is what
+ * used to be board[r][c]. Three Man Morris numbers its nine points row
+ * by row from the top left.
+ */
+typedef uint32_t bitboard;
+
+#define BIT(p)	((bitboard)1 << (p))
+
+#if defined(__GNUC__)
+#define popcount(b)	__builtin_popcount(b)
+#define lowbit(b)	__builtin_ctz(b)
+#else
+static int
+popcount(bitboard b)
+{
+  int n;
+  for (n = 0; b; n++) {
+    b &= b - 1;
+  }
+  return n;
+}
+
+static int
+lowbit(bitboard b)
+{
+  int n;
+  for (n = 0; !(b & 1); n++) {
+    b >>= 1;
+  }
+  return n;
+}
+#endif
+
+/*
+ * The static shape of a board: which points exist, who neighbours
+ * whom in each direction, and which triples of points form mills;
+ * and the few rules that differ between games played on them. Read
+ * from the board descriptions by mktables.
+ */
+struct topology {
+  char		 name[8];	/* what the game is called on the command line */
+  char		 title[24];	/* and in full */
+  int		 npoints;
+  int		 npieces;	/* pieces each player places in phase 1 */
+  int		 fly;		/* pieces left, at most, for a player to
+				   jump rather than slide; 0 if never */
+  int		 moveinhand;	/* whether pieces may slide in phase 1 */
+  int		 diagonals;	/* whether any line runs diagonally */
+  int		 nmills;
+  bitboard	 all;		/* every point on the board */
+  signed char	 nbr[MAXPOINTS][MAXDIR + 1]; /* neighbour in each
+						direction, or NOPOINT */
+  bitboard	 adj[MAXPOINTS];	/* all neighbours of a point */
+  bitboard	 mills[MAXMILLS];	/* every mill line */
+  int		 npmills[MAXPOINTS];
+  bitboard	 pmills[MAXPOINTS][MAXPMILLS]; /* the other two points of
+						  each mill through a point */
+  int		 side;		/* columns (a, b, ...) and rows (1, 2, ...) */
+  signed char	 at[MAXSIDE][MAXSIDE];	/* point at [column][row], or
+					   NOPOINT */
+  char		 names[MAXPOINTS][3];	/* coordinates of each point */
+  int		 nsyms;
+  signed char	 sym[MAXSYMS][MAXPOINTS];	/* where each symmetry takes
+						   each point */
+  int		 syminv[MAXSYMS];	/* the symmetry undoing each one */
+  bitboard	 symlut[MAXSYMS][3][256];	/* each symmetry applied to
+						   each byte of a bitboard */
+};
+
+/* Apply symmetry s of topology t to the points of b */
+#define SYMBB(t, s, b)	((t)->symlut[s][0][(b) & 0xff] | \
+			 (t)->symlut[s][1][(b) >> 8 & 0xff] | \
+			 (t)->symlut[s][2][(b) >> 16 & 0xff])
+
+/*
+ * What the evaluation looks at, for each colour. makemove keeps these
+ * up to date as pieces come and go, rather than the evaluation
+ * counting them afresh at every leaf.
+ */
+struct features {
+  unsigned char	 mob[2];	/* pieces and free neighbours, in pairs */
+  unsigned char	 mills[2];	/* closed mills */
+  unsigned char	 twos[2];	/* lines of two pieces and a free point */
+};
+
+/*
+ * A position. Everything needed to continue play fits in a few words,
+ * so positions can be copied freely. After closing a mill the player
+ * keeps the move, with remove set, until they take an opponent piece.
+ */
+typedef struct game {
+  uint64_t	 key;		/* Zobrist hash of everything below */
+  bitboard	 bb[2];		/* occupied points, by colour */
+  unsigned char	 state;		/* side to move */
+  unsigned char	 phase;
+  unsigned char	 type;
+  unsigned char	 remove;	/* state must remove a piece */
+  unsigned char	 pieces[2];	/* pieces on the board */
+  unsigned char	 inhand[2];	/* pieces yet to be placed */
+  struct features f;
+} game;
+
+/*
+ * A move packs its kind, origin and destination into 16 bits. A
+ * removal after a mill is a move of its own, by the same player.
+ */
+typedef uint16_t move_t;
+
+#define PLACE 1
+#define SLIDE 2
+#define JUMP 3
+#define REMOVE 4
+
+#define MOVE(k, f, t)	((move_t)((k) << 10 | (f) << 5 | (t)))
+#define MOVEKIND(m)	((m) >> 10)
+#define MOVEFROM(m)	((m) >> 5 & 0x1f)
+#define MOVETO(m)	((m) & 0x1f)
+#define NOMOVE 0
+
+#define MAXMOVES 128    /* more than any position can have */
+
+/*
+ * What it takes to undo a move: what the move overwrote that can't be
+ * worked back out from it. Far smaller than the position, and the
+ * board itself is put back from the move.
+ */
+struct undo {
+  uint64_t	 key;
+  struct features f;
+  move_t	 move;
+  unsigned char	 state;
+  unsigned char	 phase;
+  unsigned char	 remove;
+};
+
+/*
+ * The moves of a game so far, for taking them back, and those taken
+ * back since, for playing them again. Once full, the oldest moves can
+ * no longer be taken back.
+ */
+#define MAXUNDO 1024
+
+struct undostack {
+  struct undo	 u[MAXUNDO];
+  int		 n;		/* moves that can be taken back */
+  int		 top;		/* and the end of those that can be redone */
+};
+
+#define MOVELEN 6       /* longest move in notation, `d3sw', plus NUL */
+#define POSLEN 48       /* longest position string, plus NUL */
+
+/*
+ * Random numbers for Zobrist hashing. A position's key is the XOR of
+ * those for each piece on the board, for the number of pieces each
+ * player has in hand, for White to move and for a removal pending.
+ */
+struct zobrist {
+  uint64_t	 piece[2][MAXPOINTS];
+  uint64_t	 inhand[2][MAXHAND + 1];
+  uint64_t	 side;
+  uint64_t	 remove;
+};
+
+/*
+ * The transposition table is made of cache-line sized buckets of four
+ * entries. A new entry replaces one for the same position, or else
+ * the shallowest entry, preferring those left over from old searches.
+ *
+ * Search threads share the table without locking. Each slot holds the
+ * entry packed into one word, and a check word that is the key XORed
+ * with it; a slot torn by two threads writing at once no longer
+ * matches its key, so it reads as a miss.
+ */
+#define EXACT 0
+#define LOWER 1         /* score is a lower bound: it failed high */
+#define UPPER 2         /* score is an upper bound: it failed low */
+
+#define BUCKETSIZE 4
+
+struct ttentry {
+  move_t	 move;
+  int16_t	 score;
+  uint8_t	 depth;
+  uint8_t	 bound;
+  uint8_t	 age;
+};
+
+struct ttslot {
+  uint64_t	 check;		/* key ^ data */
+  uint64_t	 data;		/* packed struct ttentry */
+};
+
+struct ttbucket {
+  struct ttslot	 e[BUCKETSIZE];
+};
+
+struct tt {
+  struct ttbucket *b;
+  size_t	 mask;		/* number of buckets, less one */
+  uint8_t	 age;
+};
+
+/*
+ * Numbers for positions up to symmetry, with given piece counts. For
+ * each size of set, the sets of points are sorted into classes that
+ * are symmetric to each other; see rank.c.
+ */
+struct symrank {
+  const struct topology *t;
+  uint64_t	 nclasses[MAXHAND + 1];
+  uint32_t	*cls[MAXHAND + 1];	/* class of each set, by rank */
+  uint8_t	*sym[MAXHAND + 1];	/* symmetry taking each set to the
+					   representative of its class */
+  bitboard	*rep[MAXHAND + 1];	/* representative of each class */
+  uint16_t	*stab[MAXHAND + 1];	/* symmetries fixing it, as bits */
+};
+
+/*
+ * The endgame databases written by mkegdb hold a byte per position
+ * with all pieces on the board: zero for a draw, otherwise one more
+ * than the number of moves to the end, a mill and its removal counting
+ * as one move. An odd number of moves is a win for the player to move.
+ * Each file covers the positions where the player to move has m
+ * pieces and the other player o, numbered up to symmetry by
+ * symrankpos, and is cut into blocks of EGBLOCK positions that are
+ * compressed separately.
+ */
+#define EGDRAW 0
+#define EGISWIN(v)	((v) && ((v) - 1) & 1)
+#define EGISLOSS(v)	((v) && !(((v) - 1) & 1))
+#define EGDIST(v)	((v) - 1)
+#define EGVAL(d)	((d) + 1)
+#define EGMAXVAL 255
+
+#define EGBLOCK 4096
+
+struct egdb;
+
+/*
+ * An opening book holds, for positions up to symmetry and moves in
+ * them, how many games were played and how many the player making the
+ * move won and drew; see book.c.
+ */
+struct bookentry {
+  uint64_t	 key;		/* of the canonical position */
+  move_t	 move;		/* in the canonical position */
+  uint32_t	 games;
+  uint32_t	 wins;
+  uint32_t	 draws;
+};
+
+struct book;
+
+/*
+ * A game record is a few tags, such as [Game "nmm"], followed by the
+ * moves in the notation players type and the result; see record.c.
+ * Reading one is a move at a time, from a buffer of the file, so that
+ * archives of any size stream through in constant memory.
+ */
+#define UNFINISHED (-2)	/* result of a game without one */
+
+#define MAXTAGS 16
+#define TAGLEN 64	/* longest tag value, plus NUL */
+#define TOKENLEN 16	/* longest word of move text, plus NUL */
+#define RECBUF 65536
+
+struct tag {
+  char		 name[TAGLEN];
+  char		 value[TAGLEN];
+};
+
+struct record {
+  game		 start;
+  game		 g;		/* position after the moves read so far */
+  int		 plies;
+  int		 result;	/* winner, NOCOLOUR for a draw, or
+				   UNFINISHED */
+  int		 ntags;
+  struct tag	 tags[MAXTAGS];	/* other than Game, Position and Result */
+};
+
+struct recreader {
+  FILE		*fp;
+  int		 type;		/* for games without a Game tag */
+  unsigned long	 line;		/* where we are, for errors */
+  unsigned long	 gameline;	/* where the game being read began */
+  char		 error[80];	/* why reading last failed */
+  int		 ingame;	/* between its tags and its result */
+  char		 tok[TOKENLEN];	/* the word being read */
+  int		 tokpos;	/* how much of it has been played */
+  size_t	 pos;
+  size_t	 len;
+  unsigned char	 buf[RECBUF];
+};
+
+struct recwriter {
+  FILE		*fp;
+  game		 g;
+  int		 turn;		/* number of the turn being played */
+  int		 plies;
+  int		 col;		/* printed so far on this line */
+};
+
+/*
+ * Scores are in hundredths of a piece, from the point of view of the
+ * player to move. A win n plies away scores WIN - n.
+ */
+#define MAXPLY 128
+#define INFINITE 32000
+#define WIN 30000
+#define MAXWIN (MAXPLY + EGMAXVAL)	/* furthest win a score can show */
+#define DECIDED(s)	((s) >= WIN - MAXWIN || (s) <= -WIN + MAXWIN)
+#define SCORELEN 16	/* longest score from fmtscore, plus NUL */
+
+#define MAXTHREADS 64
+
+/*
+ * The state of one search: its limits, the root, what it has found so
+ * far, the principal variation being built up and what it has learnt
+ * about which moves to try first. With more than one thread, each
+ * helper gets its own copy, sharing only the table.
+ */
+struct search {
+  game		 root;
+  const struct kernel *k;	/* root's rules, while searching */
+  int		 maxdepth;
+  double	 maxtime;	/* seconds, or 0 for no limit */
+  uint64_t	 maxnodes;	/* or 0 for no limit */
+  int		 nthreads;
+  void		(*report)(const struct search *); /* called after each
+						     iteration, or NULL */
+  volatile int	 stop;		/* set to abandon the search */
+  uint64_t	 nodes;		/* searched by this thread */
+  uint64_t	 totalnodes;	/* by all threads, as of the last report */
+  uint64_t	 threadnodes[MAXTHREADS];
+  int		 id;		/* 0 for the main thread */
+  struct search	*helpers;	/* the other threads' searches */
+  double	 start;
+  double	 deadline;
+  double	 elapsed;
+  move_t	 best;		/* results of the last full iteration */
+  int		 score;
+  int		 depth;
+  int		 npv;
+  move_t	 bestpv[MAXPLY];
+  move_t	 pv[MAXPLY][MAXPLY];	/* triangular PV table */
+  int		 pvlen[MAXPLY];
+  struct tt	*tt;		/* or NULL to search without one */
+  struct egdb	*egdb;		/* or NULL to search without one */
+  struct book	*book;		/* for placing pieces, or NULL */
+  move_t	 killers[MAXPLY][2];	/* quiet moves that last cut off
+					   at each ply */
+  uint32_t	 history[2][MAXPOINTS + 1][MAXPOINTS]; /* how well each
+						  move from, or placement
+						  at (from MAXPOINTS),
+						  each point did */
+  uint32_t	 rhistory[2][MAXPOINTS]; /* and each removal */
+  uint64_t	 cutoffs;	/* beta cutoffs by this thread */
+  uint64_t	 firstcutoffs;	/* of them, on the first move tried */
+  uint64_t	 totalcutoffs;	/* by all threads, as of the last report */
+  uint64_t	 totalfirst;
+};
+
+/*
+ * A run of games of the computer against itself. Each side searches
+ * to its own depth or for its own time, or plays at random if its
+ * depth is 0. The first few plies of every game are played at random
+ * so that the games differ, and a game still going after maxplies
+ * plies is a draw.
+ */
+struct engine {
+  int		 depth;
+  double	 maxtime;	/* seconds, or 0 for no limit */
+};
+
+struct selfplay {
+  game		 start;
+  int		 ngames;
+  int		 nthreads;
+  int		 randomplies;
+  int		 maxplies;
+  uint64_t	 seed;
+  size_t	 hashmb;	/* for each side in each thread */
+  int		 verbose;	/* print every game's moves */
+  struct engine	 side[2];
+  struct egdb	*egdb;		/* or NULL to play without one */
+  struct book	*book;		/* or NULL to play without one */
+};
+
+/*
+ * A run of searches over positions read one to a line, each to the
+ * same depth, number of nodes or time. Results come out in the order
+ * the positions went in.
+ */
+struct batch {
+  FILE		*in;
+  FILE		*out;
+  int		 maxdepth;
+  uint64_t	 maxnodes;	/* or 0 for no limit */
+  double	 maxtime;	/* seconds, or 0 for no limit */
+  int		 nthreads;
+  size_t	 hashmb;	/* for each thread */
+  struct egdb	*egdb;		/* for positions of its game, or NULL */
+  int		 egtype;	/* which game that is */
+};
+
+/*
+ * The rules that run at every node, compiled once for each game with
+ * its board built in; see kernel.h. Loops that run them over and over
+ * pick out their game's with KERNEL once, at the start, and call
+ * through that.
+ */
+struct kernel {
+  int		(*coordpoint)(const char *);
+  int		(*closesmill)(const bitboard, const int);
+  bitboard	(*millpieces)(const bitboard);
+  bitboard	(*removable)(const bitboard);
+  int		(*winner)(const game *);
+  int		(*genmoves)(const game *, move_t *);
+  void		(*setphase)(game *);
+  void		(*makemove)(game *, const move_t);
+};
+
+/* Generated by mktables */
+extern const struct topology topo[NVARIANTS];
+extern const struct kernel kernels[NVARIANTS];
+extern const struct zobrist zobrist;
+extern const uint32_t binom[MAXPOINTS + 1][MAXPOINTS + 1];
+
+#define TOPO(g)		(&topo[(g)->type])
+#define KERNEL(g)	(&kernels[(g)->type])
+#define EMPTIES(g)	(TOPO(g)->all & ~((g)->bb[WHITE] | (g)->bb[BLACK]))
+/* Does colour c move by jumping to any free point? */
+#define FLIES(g, c)	(!(g)->inhand[c] && (g)->pieces[c] <= TOPO(g)->fly)
+
+__BEGIN_DECLS
+/*	 protocol.c */
+void	 runprotocol(const game *, const int, const size_t, const char *,
+		     const char *);
+/*	 rank.c */
+uint64_t rankset(bitboard);
+bitboard unrankset(uint64_t, int, const int);
+uint64_t ranksize(const struct topology *, const int, const int);
+uint64_t rankpos(const struct topology *, const int, const int, bitboard,
+		 bitboard);
+void	 unrankpos(const struct topology *, const int, const int, uint64_t,
+		   bitboard *, bitboard *);
+void	 symrankinit(struct symrank *, const struct topology *);
+int	 symrankadd(struct symrank *, const int);
+void	 symrankfree(struct symrank *);
+uint64_t symranksize(const struct symrank *, const int, const int);
+uint64_t symrankpos(const struct symrank *, const int, const int,
+		    const bitboard, const bitboard);
+void	 symunrankpos(const struct symrank *, const int, const int, uint64_t,
+		      bitboard *, bitboard *);
+/*	 rules.c */
+void	 initgame(game *, const int);
+uint64_t hashgame(const game *);
+int	 coordpoint(const game *, const char *);
+char	 pointchar(const game *, const int);
+char	 statechar(const game *);
+int	 inmill(const game *, const int);
+bitboard millpieces(const game *, const int);
+int	 canremove(const game *, const int);
+int	 surrounded(const game *);
+void	 countfeatures(const game *, struct features *);
+void	 checkfeatures(const game *);
+int	 winner(const game *);
+int	 genmoves(const game *, move_t *);
+int	 legalmove(const game *, const move_t);
+void	 makemove(game *, const move_t);
+void	 domove(game *, const move_t, struct undo *);
+void	 undomove(game *, const struct undo *);
+void	 pushmove(struct undostack *, game *, const move_t);
+int	 takeback(struct undostack *, game *);
+int	 redo(struct undostack *, game *);
+char	*fmtmove(const game *, const move_t, char *);
+int	 parsemove(const game *, const char *, move_t *);
+char	*fmtpos(const game *, char *);
+int	 parsepos(game *, const char *);
+/*	 batch.c */
+void	 runbatch(const struct batch *);
+/*	 book.c */
+move_t	 bookmove(const game *, const move_t, uint64_t *);
+int	 bookwrite(const char *, const int, const struct bookentry *,
+		   const uint64_t);
+struct book *bookopen(const char *, const int);
+void	 bookclose(struct book *);
+move_t	 bookprobe(const struct book *, const game *);
+/*	 egdb.c */
+char	*egpath(char *, const size_t, const char *, const struct topology *,
+		const int, const int);
+int	 egwrite(const char *, const struct symrank *, const int, const int,
+		 const uint8_t *);
+int	 egread(const char *, const struct symrank *, const int, const int,
+		uint8_t *);
+struct egdb *egopen(const char *, const int);
+void	 egclose(struct egdb *);
+int	 egprobe(struct egdb *, const game *);
+/*	 perft.c */
+uint64_t perft(const game *, const int);
+void	 runperft(const game *, const int, const int, int);
+/*	 record.c */
+void	 rdinit(struct recreader *, FILE *, const int);
+int	 rdgame(struct recreader *, struct record *);
+int	 rdmove(struct recreader *, struct record *, move_t *);
+const char *resultstr(const int);
+void	 wrbegin(struct recwriter *, FILE *, const struct record *);
+void	 wrmove(struct recwriter *, const move_t);
+void	 wrend(struct recwriter *, const int);
+/*	 replay.c */
+unsigned long runreplay(FILE *, FILE *, const int);
+/*	 search.c */
+int	 evaluate(const game *);
+void	 initsearch(struct search *, const game *);
+move_t	 think(struct search *);
+char	*fmtscore(const int, char *);
+char	*fmtpv(const struct search *, char *, const size_t);
+void	 analyse(struct search *);
+/*	 selfplay.c */
+void	 runselfplay(const struct selfplay *);
+/*	 server.c */
+void	 runserver(const char *, const int);
+/*	 sym.c */
+void	 symgame(const game *, const int, game *);
+move_t	 symmove(const game *, const int, const move_t);
+int	 canonsym(const game *);
+int	 canonical(const game *, game *);
+/*	 tt.c */
+int	 ttinit(struct tt *, const size_t);
+void	 ttfree(struct tt *);
+void	 ttclear(struct tt *);
+void	 ttnewsearch(struct tt *);
+int	 ttprobe(const struct tt *, const uint64_t, struct ttentry *);
+void	 ttstore(struct tt *, const uint64_t, const int, const int, const int,
+		 const move_t);
+/*	 util.c */
+double	 walltime(void);
+int	 ncpus(void);
+void	 put16(uint8_t *, const uint16_t);
+void	 put32(uint8_t *, const uint32_t);
+void	 put64(uint8_t *, const uint64_t);
+uint16_t get16(const uint8_t *);
+uint32_t get32(const uint8_t *);
+uint64_t get64(const uint8_t *);
+__END_DECLS
+
+#endif /* NMM_H */
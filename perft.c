@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Count the leaves of the game tree, for checking the rules and for
+ * timing the move generator. Every move counts as a ply, removals
+ * included. Deep counts are cut into subtrees that are shared out
+ * between threads, each with its own deque; a thread that runs out of
+ * work steals from the far end of someone else's.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nmm.h"
+
+#define TASKSPERTHREAD 32	/* split until each thread has this many */
+
+struct task {
+  game		 g;
+  int		 depth;
+  int		 root;		/* root move the subtree belongs to */
+  uint64_t	 nodes;
+};
+
+struct deque {
+  pthread_mutex_t lock;
+  struct task	**t;
+  int		 top;		/* thieves take from here */
+  int		 bottom;	/* the owner takes from here */
+};
+
+struct worker {
+  pthread_t	 tid;
+  int		 id;
+  int		 nthreads;
+  struct deque	*dq;		/* everybody's deques */
+  uint64_t	 nodes;
+};
+
+static uint64_t		 count(const struct kernel *, const game *,
+			       const int);
+static struct task	*popbottom(struct deque *);
+static struct task	*poptop(struct deque *);
+static void		*work(void *);
+static struct task	*split(const game *, int, int, int *);
+
+/*
+ * Number of leaves depth plies below g
+ */
+uint64_t
+perft(const game *g, const int depth)
+{
+  return count(KERNEL(g), g, depth);
+}
+
+/*
+ * perft, with the rules of g's game already picked out
+ */
+static uint64_t
+count(const struct kernel *k, const game *g, const int depth)
+{
+  move_t moves[MAXMOVES];
+  uint64_t nodes = 0;
+  game c;
+  int i, n;
+
+  if (depth == 0) {
+    return 1;
+  }
+  n = k->genmoves(g, moves);
+  if (depth == 1) {
+    return n;
+  }
+  for (i = 0; i < n; i++) {
+    c = *g;
+    k->makemove(&c, moves[i]);
+    nodes += count(k, &c, depth - 1);
+  }
+  return nodes;
+}
+
+static struct task *
+popbottom(struct deque *dq)
+{
+  struct task *t = NULL;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->top < dq->bottom) {
+    t = dq->t[--dq->bottom];
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return t;
+}
+
+static struct task *
+poptop(struct deque *dq)
+{
+  struct task *t = NULL;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->top < dq->bottom) {
+    t = dq->t[dq->top++];
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return t;
+}
+
+/*
+ * Work through our own deque, then steal until there's nothing left.
+ * No task creates new ones, so once every deque is empty we're done.
+ */
+static void *
+work(void *arg)
+{
+  struct worker *w = arg;
+  struct task *t;
+  int i;
+
+  for (;;) {
+    if (!(t = popbottom(&w->dq[w->id]))) {
+      for (i = 1; i < w->nthreads; i++) {
+	if ((t = poptop(&w->dq[(w->id + i) % w->nthreads]))) {
+	  break;
+	}
+      }
+    }
+    if (!t) {
+      return NULL;
+    }
+    t->nodes = perft(&t->g, t->depth);
+    w->nodes += t->nodes;
+  }
+}
+
+/*
+ * Cut the tree below g into subtrees, expanding a level at a time
+ * until there are at least want of them or they get too shallow to be
+ * worth it. Each subtree remembers which root move it came from.
+ */
+static struct task *
+split(const game *g, const int depth, const int want, int *ntasks)
+{
+  move_t moves[MAXMOVES];
+  struct task *tasks, *next;
+  int i, j, n, nnext;
+
+  if (!(tasks = malloc(MAXMOVES * sizeof(*tasks)))) {
+    err(1, "Unable to allocate perft tasks");
+  }
+  n = genmoves(g, moves);
+  for (i = 0; i < n; i++) {
+    tasks[i].g = *g;
+    makemove(&tasks[i].g, moves[i]);
+    tasks[i].depth = depth - 1;
+    tasks[i].root = i;
+  }
+  while (n > 0 && n < want && tasks[0].depth > 2) {
+    if (!(next = malloc((size_t)n * MAXMOVES * sizeof(*next)))) {
+      err(1, "Unable to allocate perft tasks");
+    }
+    for (nnext = 0, i = 0; i < n; i++) {
+      int m = genmoves(&tasks[i].g, moves);
+      for (j = 0; j < m; j++, nnext++) {
+	next[nnext].g = tasks[i].g;
+	makemove(&next[nnext].g, moves[j]);
+	next[nnext].depth = tasks[i].depth - 1;
+	next[nnext].root = tasks[i].root;
+      }
+    }
+    free(tasks);
+    tasks = next;
+    n = nnext;
+  }
+  *ntasks = n;
+  return tasks;
+}
+
+/*
+ * Count the leaves depth plies below g with nthreads threads and
+ * report the total and the speed, broken down per root move if
+ * divide is set.
+ */
+void
+runperft(const game *g, const int depth, const int divide, int nthreads)
+{
+  move_t moves[MAXMOVES];
+  uint64_t perroot[MAXMOVES] = { 0 };
+  uint64_t total = 0;
+  struct task *tasks = NULL;
+  struct deque *dq;
+  struct worker *w;
+  char buf[POSLEN];
+  double start, secs;
+  int i, n, ntasks = 0;
+
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+  printf("%s\n", fmtpos(g, buf));
+  fflush(stdout);
+  n = genmoves(g, moves);
+  start = walltime();
+  if (depth < 2) {
+    total = perft(g, depth);
+    for (i = 0; depth == 1 && i < n; i++) {
+      perroot[i] = 1;
+    }
+  } else {
+    tasks = split(g, depth, nthreads * TASKSPERTHREAD, &ntasks);
+    if (!(dq = calloc(nthreads, sizeof(*dq))) ||
+	!(w = calloc(nthreads, sizeof(*w)))) {
+      err(1, "Unable to allocate perft threads");
+    }
+    /* Deal the subtrees out like cards */
+    for (i = 0; i < nthreads; i++) {
+      pthread_mutex_init(&dq[i].lock, NULL);
+      if (!(dq[i].t = malloc((ntasks / nthreads + 1) * sizeof(*dq[i].t)))) {
+	err(1, "Unable to allocate perft deques");
+      }
+    }
+    for (i = 0; i < ntasks; i++) {
+      dq[i % nthreads].t[dq[i % nthreads].bottom++] = &tasks[i];
+    }
+    for (i = 0; i < nthreads; i++) {
+      w[i].id = i;
+      w[i].nthreads = nthreads;
+      w[i].dq = dq;
+      if (i && pthread_create(&w[i].tid, NULL, work, &w[i]) != 0) {
+	err(1, "Unable to start perft thread");
+      }
+    }
+    work(&w[0]);
+    for (i = 1; i < nthreads; i++) {
+      pthread_join(w[i].tid, NULL);
+    }
+    for (i = 0; i < ntasks; i++) {
+      perroot[tasks[i].root] += tasks[i].nodes;
+      total += tasks[i].nodes;
+    }
+    for (i = 0; i < nthreads; i++) {
+      pthread_mutex_destroy(&dq[i].lock);
+      free(dq[i].t);
+    }
+    free(dq);
+    free(w);
+    free(tasks);
+  }
+  secs = walltime() - start;
+  if (divide && depth > 0) {
+    /* The root itself is the only leaf at depth 0 */
+    for (i = 0; i < n; i++) {
+      printf("%s: %llu\n", fmtmove(g, moves[i], buf),
+	     (unsigned long long)perroot[i]);
+    }
+  }
+  printf("perft %d: %llu nodes in %.3f s (%.0f nodes/s, %d thread%s)\n",
+	 depth, (unsigned long long)total, secs,
+	 secs > 0 ? total / secs : 0.0, nthreads, nthreads == 1 ? "" : "s");
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Engine mode: a line protocol on standard input and output so that
+ * other programs can use the computer player. Each command is a line
+ * of words:
+ *
+ *   variant <game>		start a new game of that variant
+ *   position start|<position> [moves <move> ...]
+ *				set up a position (see fmtpos), then
+ *				play moves in it
+ *   moves <move> ...		play moves in the current position
+ *   go [depth n] [time s] [nodes n]
+ *				search the current position; without
+ *				limits, until stopped or decided
+ *   stop			abandon the search, answering at once
+ *   isready			answered with readyok
+ *   new			forget everything searched so far
+ *   hash <mb>			resize the hash table
+ *   threads <n>		search with n threads
+ *   show			print the current position
+ *   quit
+ *
+ * The search runs in a thread of its own, so commands are read while
+ * it runs. It prints an info line after each iteration and a bestmove
+ * line when it's done; a command other than stop or isready that
+ * arrives in the meantime stops it first. Problems are reported on an
+ * error line.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+#define SEPS " \t\r\n"
+
+struct session {
+  game		 g;
+  struct search	 s;
+  struct tt	 tt;
+  int		 nthreads;
+  pthread_t	 tid;
+  int		 searching;	/* tid is to be joined */
+  const char	*egdir;
+  struct egdb	*egdb;		/* for egtype, or NULL */
+  int		 egtype;
+  const char	*bookpath;
+  struct book	*book;		/* for booktype, or NULL */
+  int		 booktype;
+};
+
+static pthread_mutex_t outlock = PTHREAD_MUTEX_INITIALIZER;
+
+static void	 say(const char *, ...);
+static void	 info(const struct search *);
+static void	*searcher(void *);
+static void	 stop(struct session *);
+static int	 playmoves(game *, char *);
+static void	 position(struct session *, char *);
+static void	 go(struct session *, char *);
+static int	 command(struct session *, char *);
+
+/*
+ * Print a line. The search thread prints too, so lines are written
+ * whole.
+ */
+static void
+say(const char *fmt, ...)
+{
+  va_list ap;
+
+  pthread_mutex_lock(&outlock);
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+  putchar('\n');
+  fflush(stdout);
+  pthread_mutex_unlock(&outlock);
+}
+
+/*
+ * Report an iteration. Forced wins and losses are given in plies.
+ */
+static void
+info(const struct search *s)
+{
+  char buf[MAXPLY * MOVELEN], score[SCORELEN];
+
+  say("info depth %d score %s nodes %llu nps %.0f time %.3f pv %s",
+      s->depth, fmtscore(s->score, score), (unsigned long long)s->totalnodes,
+      s->elapsed > 0 ? s->totalnodes / s->elapsed : 0.0, s->elapsed,
+      fmtpv(s, buf, sizeof(buf)));
+}
+
+static void *
+searcher(void *arg)
+{
+  struct search *s = arg;
+  char buf[MOVELEN];
+  move_t m;
+
+  m = think(s);
+  say("bestmove %s", m == NOMOVE ? "none" : fmtmove(&s->root, m, buf));
+  return NULL;
+}
+
+/*
+ * Stop the search, if there is one, and wait for its answer
+ */
+static void
+stop(struct session *ss)
+{
+  if (ss->searching) {
+    ss->s.stop = 1;
+    pthread_join(ss->tid, NULL);
+    ss->searching = 0;
+  }
+}
+
+/*
+ * Play the moves in the words of line. Returns 0, or -1, leaving g
+ * untouched, if one of them is illegal.
+ */
+static int
+playmoves(game *g, char *line)
+{
+  game c = *g;
+  char *w;
+  move_t m;
+
+  for (w = strtok(line, SEPS); w; w = strtok(NULL, SEPS)) {
+    if (parsemove(&c, w, &m) != (int)strlen(w)) {
+      say("error illegal move %s", w);
+      return -1;
+    }
+    makemove(&c, m);
+  }
+  *g = c;
+  return 0;
+}
+
+static void
+position(struct session *ss, char *args)
+{
+  char *moves;
+  game g;
+
+  if ((moves = strstr(args, "moves"))) {
+    *moves = '\0';
+    moves += strlen("moves");
+  }
+  args += strspn(args, SEPS);
+  if (strncmp(args, "start", strlen("start")) == 0) {
+    initgame(&g, ss->g.type);
+  } else if (parsepos(&g, args) == -1) {
+    say("error invalid position");
+    return;
+  }
+  if (moves && playmoves(&g, moves) == -1) {
+    return;
+  }
+  ss->g = g;
+}
+
+static void
+go(struct session *ss, char *args)
+{
+  struct search *s = &ss->s;
+  char *w, *v;
+
+  initsearch(s, &ss->g);
+  s->maxtime = 0;
+  for (w = strtok(args, SEPS); w; w = strtok(NULL, SEPS)) {
+    if (!(v = strtok(NULL, SEPS))) {
+      say("error %s needs a value", w);
+      return;
+    }
+    if (strcmp(w, "depth") == 0) {
+      if ((s->maxdepth = atoi(v)) < 1 || s->maxdepth > MAXPLY - 1) {
+	s->maxdepth = MAXPLY - 1;
+      }
+    } else if (strcmp(w, "time") == 0) {
+      s->maxtime = atof(v);
+    } else if (strcmp(w, "nodes") == 0) {
+      s->maxnodes = strtoull(v, NULL, 10);
+    } else {
+      say("error unknown limit %s", w);
+      return;
+    }
+  }
+  if (ss->egdir && ss->egtype != ss->g.type) {
+    if (ss->egdb) {
+      egclose(ss->egdb);
+    }
+    ss->egtype = ss->g.type;
+    if (!(ss->egdb = egopen(ss->egdir, ss->egtype))) {
+      say("error no endgame databases for %s in %s",
+	  TOPO(&ss->g)->name, ss->egdir);
+    }
+  }
+  if (ss->bookpath && ss->booktype != ss->g.type) {
+    if (ss->book) {
+      bookclose(ss->book);
+    }
+    ss->booktype = ss->g.type;
+    if (!(ss->book = bookopen(ss->bookpath, ss->booktype))) {
+      say("error %s is no book for %s", ss->bookpath, TOPO(&ss->g)->name);
+    }
+  }
+  s->nthreads = ss->nthreads;
+  s->tt = &ss->tt;
+  s->egdb = ss->egdb;
+  s->book = ss->book;
+  s->report = info;
+  if (pthread_create(&ss->tid, NULL, searcher, s) != 0) {
+    say("error unable to start the search");
+    return;
+  }
+  ss->searching = 1;
+}
+
+/*
+ * Carry out one line of input. Returns 0, or -1 once told to quit.
+ */
+static int
+command(struct session *ss, char *line)
+{
+  char buf[POSLEN], *cmd, *args, *end = line + strlen(line);
+  int i, n;
+
+  if (!(cmd = strtok(line, SEPS))) {
+    return 0;
+  }
+  if ((args = cmd + strlen(cmd)) < end) {
+    args++;
+  }
+  if (strcmp(cmd, "isready") == 0) {
+    say("readyok");
+    return 0;
+  }
+  /* Anything else that comes in mid-search is for a new position */
+  stop(ss);
+  if (strcmp(cmd, "quit") == 0) {
+    return -1;
+  } else if (strcmp(cmd, "stop") == 0) {
+    return 0;
+  } else if (strcmp(cmd, "variant") == 0) {
+    cmd = strtok(NULL, SEPS);
+    for (i = 0; i < NVARIANTS; i++) {
+      if (cmd && strcmp(cmd, topo[i].name) == 0) {
+	break;
+      }
+    }
+    if (i == NVARIANTS) {
+      say("error unknown variant");
+      return 0;
+    }
+    initgame(&ss->g, i);
+  } else if (strcmp(cmd, "position") == 0) {
+    position(ss, args);
+  } else if (strcmp(cmd, "moves") == 0) {
+    playmoves(&ss->g, args);
+  } else if (strcmp(cmd, "go") == 0) {
+    go(ss, args);
+  } else if (strcmp(cmd, "new") == 0) {
+    ttclear(&ss->tt);
+  } else if (strcmp(cmd, "hash") == 0) {
+    if ((cmd = strtok(NULL, SEPS)) && (n = atoi(cmd)) > 0) {
+      ttfree(&ss->tt);
+      if (ttinit(&ss->tt, n) == -1) {
+	err(1, "Unable to allocate the hash table");
+      }
+    } else {
+      say("error hash needs a size in megabytes");
+    }
+  } else if (strcmp(cmd, "threads") == 0) {
+    if ((cmd = strtok(NULL, SEPS)) && (n = atoi(cmd)) > 0 &&
+	n <= MAXTHREADS) {
+      ss->nthreads = n;
+    } else {
+      say("error threads must be between 1 and %d", MAXTHREADS);
+    }
+  } else if (strcmp(cmd, "show") == 0) {
+    say("position %s", fmtpos(&ss->g, buf));
+  } else {
+    say("error unknown command %s", cmd);
+  }
+  return 0;
+}
+
+/*
+ * Speak the protocol on standard input and output until told to quit
+ * or the input runs out, starting from position g
+ */
+void
+runprotocol(const game *g, const int nthreads, const size_t hashmb,
+	    const char *egdir, const char *bookpath)
+{
+  struct session *ss;
+  char *line = NULL;
+  size_t size = 0;
+
+  if (!(ss = calloc(1, sizeof(*ss)))) {
+    err(1, "Unable to allocate the engine");
+  }
+  if (ttinit(&ss->tt, hashmb) == -1) {
+    err(1, "Unable to allocate the hash table");
+  }
+  ss->g = *g;
+  ss->nthreads = nthreads;
+  ss->egdir = egdir;
+  ss->bookpath = bookpath;
+  /* Neither is opened until there's a search */
+  ss->egtype = ss->booktype = -1;
+  while (getline(&line, &size, stdin) != -1 && command(ss, line) == 0)
+    ;
+  stop(ss);
+  free(line);
+  if (ss->egdb) {
+    egclose(ss->egdb);
+  }
+  if (ss->book) {
+    bookclose(ss->book);
+  }
+  ttfree(&ss->tt);
+  free(ss);
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Numbering positions densely, for tables with an entry for every
+ * position with given piece counts. A position is a pair of disjoint
+ * sets of points: the first player's n1 pieces, then the second
+ * player's n2 among the points left over. Each set is numbered in
+ * colexicographic order, which is just the order of their bitboards,
+ * so that
+ *
+ *	rank = rank(first) * C(npoints - n1, n2) + rank(second)
+ *
+ * runs from 0 to C(npoints, n1) * C(npoints - n1, n2) - 1.
+ *
+ * Up to symmetry, the first set is replaced by the number of its
+ * class, and the second set is moved by the symmetry taking the first
+ * to the representative of its class. When that representative is
+ * itself symmetric, the second set can still be placed more than one
+ * way; we take the smallest number. Every position symmetric to
+ * another then gets the same number, and unranking gives the one
+ * position of the class with that number. Numbers unranking to a
+ * position that ranks differently are unused.
+ */
+
+#include <stdlib.h>
+
+#include "nmm.h"
+
+static bitboard	 squeeze(bitboard, bitboard);
+static bitboard	 expand(const struct topology *, const bitboard,
+			bitboard);
+
+/*
+ * Number a set of points among the sets of the same size
+ */
+uint64_t
+rankset(bitboard b)
+{
+  uint64_t r = 0;
+  int i;
+
+  for (i = 1; b; b &= b - 1, i++) {
+    r += binom[lowbit(b)][i];
+  }
+  return r;
+}
+
+/*
+ * The set of k of the points 0 to n - 1 numbered r
+ */
+bitboard
+unrankset(uint64_t r, int k, const int n)
+{
+  bitboard b = 0;
+  uint32_t c;
+  int p, in;
+
+  /*
+   * Whether each point is in is a coin toss, so decide it without a
+   * branch the processor would keep guessing wrong
+   */
+  for (p = n - 1; k > 0; p--) {
+    c = binom[p][k];
+    in = c <= r;
+    r -= c & -(uint32_t)in;
+    b |= (bitboard)in << p;
+    k -= in;
+  }
+  return b;
+}
+
+/*
+ * Renumber the points of b as if the points of used weren't there
+ */
+static bitboard
+squeeze(bitboard b, bitboard used)
+{
+  int i, q;
+
+  for (i = 0; used; used &= used - 1, i++) {
+    /* The points of used below this one already moved it down by i */
+    q = lowbit(used) - i;
+    b = (b & (BIT(q) - 1)) | (b >> 1 & ~(BIT(q) - 1));
+  }
+  return b;
+}
+
+/*
+ * Undo squeeze
+ */
+static bitboard
+expand(const struct topology *t, const bitboard used, bitboard s)
+{
+  bitboard b = 0, free = t->all & ~used;
+
+  for (; s; s >>= 1, free &= free - 1) {
+    b |= free & -free & -(bitboard)(s & 1);
+  }
+  return b;
+}
+
+uint64_t
+ranksize(const struct topology *t, const int n1, const int n2)
+{
+  return (uint64_t)binom[t->npoints][n1] * binom[t->npoints - n1][n2];
+}
+
+uint64_t
+rankpos(const struct topology *t, const int n1, const int n2, bitboard b1,
+	bitboard b2)
+{
+  return rankset(b1) * binom[t->npoints - n1][n2] +
+    rankset(squeeze(b2, b1));
+}
+
+void
+unrankpos(const struct topology *t, const int n1, const int n2, uint64_t i,
+	  bitboard *b1, bitboard *b2)
+{
+  uint64_t n = binom[t->npoints - n1][n2];
+
+  *b1 = unrankset(i / n, n1, t->npoints);
+  *b2 = expand(t, *b1, unrankset(i % n, n2, t->npoints - n1));
+}
+
+/* ****
+ * Up to symmetry
+ * **** */
+
+/*
+ * Get ready to number positions of t up to symmetry. Nothing can be
+ * numbered until symrankadd has been called for the first set's size.
+ */
+void
+symrankinit(struct symrank *sr, const struct topology *t)
+{
+  int k;
+
+  sr->t = t;
+  for (k = 0; k <= MAXHAND; k++) {
+    sr->nclasses[k] = 0;
+    sr->cls[k] = NULL;
+    sr->sym[k] = NULL;
+    sr->rep[k] = NULL;
+    sr->stab[k] = NULL;
+  }
+}
+
+/*
+ * Sort the sets of k points into classes of symmetric sets. Returns 0,
+ * or -1 if out of memory.
+ */
+int
+symrankadd(struct symrank *sr, const int k)
+{
+  const struct topology *t = sr->t;
+  uint64_t n = binom[t->npoints][k], r;
+  uint32_t c, nc = 0;
+  bitboard b, v, best, *rep;
+  uint16_t *stab;
+  int s, bests;
+
+  if (sr->cls[k]) {
+    return 0;
+  }
+  if (!(sr->cls[k] = malloc(n * sizeof(*sr->cls[k]))) ||
+      !(sr->sym[k] = malloc(n)) ||
+      !(sr->rep[k] = malloc(n * sizeof(*sr->rep[k]))) ||
+      !(sr->stab[k] = malloc(n * sizeof(*sr->stab[k])))) {
+    symrankfree(sr);
+    return -1;
+  }
+  for (r = 0; r < n; r++) {
+    b = unrankset(r, k, t->npoints);
+    best = b;
+    bests = 0;
+    for (s = 1; s < t->nsyms; s++) {
+      if ((v = SYMBB(t, s, b)) < best) {
+	best = v;
+	bests = s;
+      }
+    }
+    sr->sym[k][r] = bests;
+    if (best == b) {
+      /* The smallest of its class, so the first we've seen */
+      c = nc++;
+      sr->rep[k][c] = b;
+      sr->stab[k][c] = 0;
+      for (s = 0; s < t->nsyms; s++) {
+	if (SYMBB(t, s, b) == b) {
+	  sr->stab[k][c] |= 1 << s;
+	}
+      }
+    } else {
+      /* Sets are numbered in bitboard order, so its class is known */
+      c = sr->cls[k][rankset(best)];
+    }
+    sr->cls[k][r] = c;
+  }
+  sr->nclasses[k] = nc;
+  /* Give back the room for classes there turned out not to be */
+  if ((rep = realloc(sr->rep[k], nc * sizeof(*rep)))) {
+    sr->rep[k] = rep;
+  }
+  if ((stab = realloc(sr->stab[k], nc * sizeof(*stab)))) {
+    sr->stab[k] = stab;
+  }
+  return 0;
+}
+
+void
+symrankfree(struct symrank *sr)
+{
+  int k;
+
+  for (k = 0; k <= MAXHAND; k++) {
+    free(sr->cls[k]);
+    free(sr->sym[k]);
+    free(sr->rep[k]);
+    free(sr->stab[k]);
+  }
+  symrankinit(sr, sr->t);
+}
+
+uint64_t
+symranksize(const struct symrank *sr, const int n1, const int n2)
+{
+  return sr->nclasses[n1] * binom[sr->t->npoints - n1][n2];
+}
+
+uint64_t
+symrankpos(const struct symrank *sr, const int n1, const int n2,
+	   const bitboard b1, const bitboard b2)
+{
+  const struct topology *t = sr->t;
+  uint64_t r = rankset(b1), best, v;
+  uint32_t c = sr->cls[n1][r];
+  bitboard rep = sr->rep[n1][c];
+  bitboard b = SYMBB(t, sr->sym[n1][r], b2);
+  unsigned int stab;
+  int s;
+
+  best = rankset(squeeze(b, rep));
+  for (stab = sr->stab[n1][c] & ~1U; stab; stab &= stab - 1) {
+    s = lowbit(stab);
+    if ((v = rankset(squeeze(SYMBB(t, s, b), rep))) < best) {
+      best = v;
+    }
+  }
+  return c * (uint64_t)binom[t->npoints - n1][n2] + best;
+}
+
+void
+symunrankpos(const struct symrank *sr, const int n1, const int n2,
+	     uint64_t i, bitboard *b1, bitboard *b2)
+{
+  const struct topology *t = sr->t;
+  uint64_t n = binom[t->npoints - n1][n2];
+
+  *b1 = sr->rep[n1][i / n];
+  *b2 = expand(t, *b1, unrankset(i % n, n2, t->npoints - n1));
+}
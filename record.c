@@ -0,0 +1,522 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Game records. A record is a few tags, one to a line, and then the
+ * moves and the result:
+ *
+ *   [Game "nmm"]
+ *   [Round "12"]
+ *   [Result "0-1"]
+ *
+ *   1. d2 f4 2. d6 b4 3. f6 d3 4. b6xf4 ...  0-1
+ *
+ * Game names the variant, defaulting to the one being read. Position
+ * gives the start as fmtpos writes it, when it isn't the usual one.
+ * Other tags are kept but mean nothing to us. Moves are written as
+ * players type them, numbered by turn with Black moving first, and a
+ * removal is an `x' and its point, following the move that closed the
+ * mill without a space. The result is 1-0 if White won, 0-1 if Black
+ * won, 1/2-1/2 for a draw and `*' for a game that didn't finish; the
+ * last game in a file may also leave it off, as a file of moves alone
+ * would. Text in braces, or from a semicolon to the end of the line,
+ * is a comment.
+ *
+ * The reader works from a buffer of the file a character at a time,
+ * and hands back each move as it is read, checked against the rules
+ * and played, so it allocates nothing and holds no more than one
+ * position of a game however long the archive. After an error it
+ * skips to the end of the game to carry on with the next.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nmm.h"
+
+static int	 fill(struct recreader *);
+static int	 nextc(struct recreader *);
+static void	 unread(struct recreader *, const int);
+static int	 fail(struct recreader *, const char *, ...);
+static int	 skipspace(struct recreader *);
+static int	 readword(struct recreader *);
+static int	 readtag(struct recreader *, struct record *, int *, char *);
+static int	 parseresult(const char *, int *);
+static void	 skipgame(struct recreader *);
+static void	 wrword(struct recwriter *, const char *);
+
+/* Characters that end a word of move text */
+static const unsigned char endsword[UCHAR_MAX + 1] = {
+  [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1,
+  ['{'] = 1, [';'] = 1, ['['] = 1
+};
+
+/* ********************************
+ * Reading
+ * ******************************** */
+
+/*
+ * Read games of type, unless they say otherwise, from fp
+ */
+void
+rdinit(struct recreader *r, FILE *fp, const int type)
+{
+  r->fp = fp;
+  r->type = type;
+  r->line = r->gameline = 1;
+  r->error[0] = '\0';
+  r->ingame = 0;
+  r->tok[0] = '\0';
+  r->tokpos = 0;
+  r->pos = r->len = 0;
+}
+
+static int
+fill(struct recreader *r)
+{
+  r->pos = 0;
+  r->len = fread(r->buf, 1, sizeof(r->buf), r->fp);
+  return r->len > 0;
+}
+
+static int
+nextc(struct recreader *r)
+{
+  int c;
+
+  if (r->pos == r->len && !fill(r)) {
+    return EOF;
+  }
+  c = r->buf[r->pos++];
+  r->line += c == '\n';
+  return c;
+}
+
+/*
+ * Put back c, the character nextc just returned
+ */
+static void
+unread(struct recreader *r, const int c)
+{
+  if (c != EOF) {
+    r->pos--;
+    r->line -= c == '\n';
+  }
+}
+
+static int
+fail(struct recreader *r, const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  vsnprintf(r->error, sizeof(r->error), fmt, ap);
+  va_end(ap);
+  return -1;
+}
+
+/*
+ * Skip blanks and comments, returning the character after them
+ * without reading it
+ */
+static int
+skipspace(struct recreader *r)
+{
+  int c;
+
+  for (;;) {
+    if ((c = nextc(r)) == '{') {
+      while ((c = nextc(r)) != '}' && c != EOF) {
+	continue;
+      }
+    } else if (c == ';') {
+      while ((c = nextc(r)) != '\n' && c != EOF) {
+	continue;
+      }
+    } else if (c == EOF || !isspace(c)) {
+      unread(r, c);
+      return c;
+    }
+  }
+}
+
+/*
+ * Read a word of move text into r->tok. Returns its length, or -1 if
+ * it is too long, having skipped it all the same. Words hold no
+ * newlines, so they are scanned straight from the buffer.
+ */
+static int
+readword(struct recreader *r)
+{
+  const unsigned char *b, *end;
+  int n = 0;
+
+  do {
+    end = r->buf + r->len;
+    for (b = r->buf + r->pos; b < end && !endsword[*b]; b++, n++) {
+      if (n < TOKENLEN - 1) {
+	r->tok[n] = *b;
+      }
+    }
+    r->pos = b - r->buf;
+  } while (b == end && fill(r));
+  r->tok[n < TOKENLEN - 1 ? n : TOKENLEN - 1] = '\0';
+  r->tokpos = 0;
+  return n < TOKENLEN ? n : -1;
+}
+
+/*
+ * Read a tag, starting at its `['. Game sets *type, Position is
+ * copied to pos, and the rest go into rec. Returns 0, or -1 if it
+ * isn't a tag.
+ */
+static int
+readtag(struct recreader *r, struct record *rec, int *type, char *pos)
+{
+  char name[TAGLEN], value[TAGLEN];
+  int c, i, n;
+
+  nextc(r);
+  for (n = 0; (c = nextc(r)) != EOF && (isalnum(c) || c == '_'); n++) {
+    if (n == TAGLEN - 1) {
+      return fail(r, "tag name too long");
+    }
+    name[n] = c;
+  }
+  name[n] = '\0';
+  while (c == ' ' || c == '\t') {
+    c = nextc(r);
+  }
+  if (n == 0 || c != '"') {
+    return fail(r, "malformed tag");
+  }
+  for (n = 0; (c = nextc(r)) != '"'; n++) {
+    if (c == '\\') {
+      c = nextc(r);
+    }
+    if (c == EOF || c == '\n') {
+      return fail(r, "unterminated tag %s", name);
+    } else if (n == TAGLEN - 1) {
+      return fail(r, "tag %s too long", name);
+    }
+    value[n] = c;
+  }
+  value[n] = '\0';
+  while ((c = nextc(r)) == ' ' || c == '\t') {
+    continue;
+  }
+  if (c != ']') {
+    return fail(r, "malformed tag %s", name);
+  }
+  if (strcmp(name, "Game") == 0) {
+    for (i = 0; i < NVARIANTS; i++) {
+      if (strcmp(value, topo[i].name) == 0) {
+	break;
+      }
+    }
+    if (i == NVARIANTS) {
+      return fail(r, "unknown game %s", value);
+    }
+    *type = i;
+  } else if (strcmp(name, "Position") == 0) {
+    strcpy(pos, value);
+  } else if (strcmp(name, "Result") != 0) {
+    /* The result that counts is the one after the moves */
+    if (rec->ntags == MAXTAGS) {
+      return fail(r, "too many tags");
+    }
+    strcpy(rec->tags[rec->ntags].name, name);
+    strcpy(rec->tags[rec->ntags].value, value);
+    rec->ntags++;
+  }
+  return 0;
+}
+
+/*
+ * Set *result from s if it is a result. Returns 0, or -1 if it isn't.
+ */
+static int
+parseresult(const char *s, int *result)
+{
+  /* Most words are moves, which no result starts like */
+  if (s[0] != '0' && s[0] != '1' && s[0] != '*') {
+    return -1;
+  } else if (strcmp(s, "1-0") == 0) {
+    *result = WHITE;
+  } else if (strcmp(s, "0-1") == 0) {
+    *result = BLACK;
+  } else if (strcmp(s, "1/2-1/2") == 0) {
+    *result = NOCOLOUR;
+  } else if (strcmp(s, "*") == 0) {
+    *result = UNFINISHED;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Skip the rest of a game that couldn't be read, up to its result
+ */
+static void
+skipgame(struct recreader *r)
+{
+  int c, result;
+
+  while ((c = skipspace(r)) != EOF) {
+    if (c == '[') {
+      while ((c = nextc(r)) != ']' && c != '\n' && c != EOF) {
+	continue;
+      }
+    } else if (readword(r) != -1 && parseresult(r->tok, &result) == 0) {
+      break;
+    }
+  }
+  r->ingame = 0;
+}
+
+/*
+ * Start reading the next game: its tags, and where it starts from.
+ * Returns 1, 0 at the end of the file, or -1 with r->error set if the
+ * tags make no sense.
+ */
+int
+rdgame(struct recreader *r, struct record *rec)
+{
+  char pos[TAGLEN];
+  int c, type = NOCOLOUR;
+
+  if (r->ingame) {
+    skipgame(r);
+  }
+  rec->plies = 0;
+  rec->result = UNFINISHED;
+  rec->ntags = 0;
+  pos[0] = '\0';
+  r->tok[0] = '\0';
+  r->tokpos = 0;
+  if ((c = skipspace(r)) == EOF) {
+    return 0;
+  }
+  r->gameline = r->line;
+  /* Any error from here on is in this game */
+  r->ingame = 1;
+  for (; c == '['; c = skipspace(r)) {
+    if (readtag(r, rec, &type, pos) == -1) {
+      return -1;
+    }
+  }
+  if (pos[0]) {
+    if (parsepos(&rec->start, pos) == -1) {
+      return fail(r, "bad position %s", pos);
+    } else if (type != NOCOLOUR && rec->start.type != type) {
+      return fail(r, "position is not one of %s", topo[type].name);
+    }
+  } else {
+    initgame(&rec->start, type == NOCOLOUR ? r->type : type);
+  }
+  rec->g = rec->start;
+  return 1;
+}
+
+/*
+ * Read the next move of the game into *m and play it in rec->g.
+ * Returns 1, 0 at the end of the game with rec->result set, or -1
+ * with r->error set if the move is illegal or the game is broken off.
+ */
+int
+rdmove(struct recreader *r, struct record *rec, move_t *m)
+{
+  const char *s;
+  int c, n, w;
+
+  while (!r->tok[r->tokpos]) {
+    c = skipspace(r);
+    if (c == EOF && rec->plies) {
+      /* Moves alone, as typed, may stop without a result */
+      r->ingame = 0;
+      return 0;
+    } else if (c == EOF || c == '[') {
+      /* Nothing to skip before the next game */
+      r->ingame = 0;
+      return fail(r, "game has no result");
+    }
+    if (readword(r) == -1) {
+      return fail(r, "`%s...' is too long for a move", r->tok);
+    }
+    if (parseresult(r->tok, &rec->result) == 0) {
+      r->ingame = 0;
+      r->tok[0] = '\0';
+      w = winner(&rec->g);
+      if (w != NOCOLOUR && rec->result != w) {
+	return fail(r, "result should be %s", resultstr(w));
+      }
+      return 0;
+    }
+    /* Move numbers, like `12.' or `12...', may be run into the move */
+    for (s = r->tok; isdigit((unsigned char)*s); s++) {
+      continue;
+    }
+    if (s != r->tok && *s == '.') {
+      while (*s == '.') {
+	s++;
+      }
+      r->tokpos = s - r->tok;
+    }
+  }
+  s = r->tok + r->tokpos;
+  if (winner(&rec->g) != NOCOLOUR) {
+    return fail(r, "move %s after the end of the game", s);
+  } else if ((n = parsemove(&rec->g, s, m)) == 0) {
+    return fail(r, "illegal move %s", s);
+  }
+  makemove(&rec->g, *m);
+  rec->plies++;
+  r->tokpos += n;
+  return 1;
+}
+
+/*
+ * The result as it is written after the moves
+ */
+const char *
+resultstr(const int result)
+{
+  switch (result)
+  {
+  case WHITE:
+    return "1-0";
+
+  case BLACK:
+    return "0-1";
+
+  case NOCOLOUR:
+    return "1/2-1/2";
+
+  default:
+    return "*";
+  }
+}
+
+/* ********************************
+ * Writing
+ * ******************************** */
+
+/*
+ * Start writing the game rec to fp, up to the moves
+ */
+void
+wrbegin(struct recwriter *w, FILE *fp, const struct record *rec)
+{
+  char buf[POSLEN];
+  const char *s;
+  game init;
+  int i;
+
+  w->fp = fp;
+  w->g = rec->start;
+  w->turn = 1;
+  w->col = 0;
+  w->plies = 0;
+  fprintf(fp, "[Game \"%s\"]\n", TOPO(&rec->start)->name);
+  initgame(&init, rec->start.type);
+  if (rec->start.key != init.key) {
+    fprintf(fp, "[Position \"%s\"]\n", fmtpos(&rec->start, buf));
+  }
+  for (i = 0; i < rec->ntags; i++) {
+    fprintf(fp, "[%s \"", rec->tags[i].name);
+    for (s = rec->tags[i].value; *s; s++) {
+      if (*s == '"' || *s == '\\') {
+	putc('\\', fp);
+      }
+      putc(*s, fp);
+    }
+    fputs("\"]\n", fp);
+  }
+  fprintf(fp, "[Result \"%s\"]\n\n", resultstr(rec->result));
+}
+
+/*
+ * Write s, starting a new line if it won't fit on this one
+ */
+static void
+wrword(struct recwriter *w, const char *s)
+{
+  int len = strlen(s);
+
+  if (w->col > 0 && w->col + 1 + len > 79) {
+    putc('\n', w->fp);
+    w->col = 0;
+  } else if (w->col > 0) {
+    putc(' ', w->fp);
+    w->col++;
+  }
+  fputs(s, w->fp);
+  w->col += len;
+}
+
+/*
+ * Write the legal move m, numbering Black's moves and White's first
+ * if the game starts with it
+ */
+void
+wrmove(struct recwriter *w, const move_t m)
+{
+  char buf[TOKENLEN], move[MOVELEN];
+  int s = w->g.state;
+
+  fmtmove(&w->g, m, move);
+  if (MOVEKIND(m) == REMOVE) {
+    /* Straight after the move that closed the mill */
+    fputs(move, w->fp);
+    w->col += strlen(move);
+  } else if (s == BLACK || w->plies == 0) {
+    snprintf(buf, sizeof(buf), "%d.%s %s", w->turn, s == BLACK ? "" : "..",
+	     move);
+    wrword(w, buf);
+  } else {
+    wrword(w, move);
+  }
+  makemove(&w->g, m);
+  w->plies++;
+  if (s == WHITE && w->g.state == BLACK) {
+    w->turn++;
+  }
+}
+
+/*
+ * Finish the game with its result
+ */
+void
+wrend(struct recwriter *w, const int result)
+{
+  wrword(w, resultstr(result));
+  fputs("\n\n", w->fp);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Replay game records through the rules, with no terminal, as a check
+ * on an archive or on the rules themselves. Every move is read with
+ * the same reader mkbook uses, so each one is checked for legality and
+ * played as it goes; a game ends at its result, or at the first move
+ * that isn't legal.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nmm.h"
+
+/*
+ * Play through every game in in, which are of type unless they say
+ * otherwise, and write a line for each to out: the line the game
+ * began on, the plies played, the final position and the result. A
+ * game that can't be read gets why instead of the result, after the
+ * position before the move at fault. A report follows on standard
+ * error. Returns the number of games in error.
+ */
+unsigned long
+runreplay(FILE *in, FILE *out, const int type)
+{
+  struct recreader *r;
+  struct record rec;
+  char buf[POSLEN];
+  unsigned long games = 0, errors = 0, plies = 0;
+  double start, secs;
+  move_t m;
+  int c;
+
+  if (!(r = malloc(sizeof(*r)))) {
+    err(1, "Unable to allocate the reader");
+  }
+  rdinit(r, in, type);
+  start = walltime();
+  while ((c = rdgame(r, &rec)) != 0) {
+    games++;
+    if (c == -1) {
+      /* There's no position to speak of */
+      errors++;
+      fprintf(out, "line %lu error line %lu: %s\n", r->gameline, r->line,
+	      r->error);
+      continue;
+    }
+    while ((c = rdmove(r, &rec, &m)) == 1) {
+      continue;
+    }
+    plies += rec.plies;
+    fprintf(out, "line %lu plies %d position %s ", r->gameline, rec.plies,
+	    fmtpos(&rec.g, buf));
+    if (c == -1) {
+      errors++;
+      fprintf(out, "error line %lu: %s\n", r->line, r->error);
+    } else {
+      fprintf(out, "result %s\n", resultstr(rec.result));
+    }
+  }
+  secs = walltime() - start;
+  fflush(out);
+  fprintf(stderr, "games %lu in %.3f s (%.1f games/s), %lu in error\n",
+	  games, secs, secs > 0 ? games / secs : 0.0, errors);
+  fprintf(stderr, "plies %lu (%.0f plies/s)\n", plies,
+	  secs > 0 ? plies / secs : 0.0);
+  free(r);
+  return errors;
+}
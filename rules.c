@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+/* Direction names, indexed by NORTH, SOUTH, WEST, EAST, NE, SW, NW, SE */
+static const char *const dirnames[MAXDIR + 1] = {
+  "n", "s", "w", "e", "ne", "sw", "nw", "se"
+};
+
+static int	 readpoint(const game *, const char *);
+
+/* **************************
+ * Game creation
+ * ************************** */
+
+/*
+ * Reset a game of the given type to its initial position
+ */
+void
+initgame(game *g, const int type)
+{
+  memset(g, 0, sizeof(*g));
+  g->type = (0 <= type && type < NVARIANTS) ? type : NMM;
+  /* We'll assume that, as in chess, black moves first */
+  g->state = BLACK;
+  g->phase = 1;
+  g->inhand[WHITE] = g->inhand[BLACK] = TOPO(g)->npieces;
+  g->key = hashgame(g);
+}
+
+/*
+ * Compute the Zobrist key of g from scratch. makemove keeps it up to
+ * date after that.
+ */
+uint64_t
+hashgame(const game *g)
+{
+  uint64_t key = 0;
+  bitboard b;
+  int c;
+
+  for (c = WHITE; c <= BLACK; c++) {
+    for (b = g->bb[c]; b; b &= b - 1) {
+      key ^= zobrist.piece[c][lowbit(b)];
+    }
+    key ^= zobrist.inhand[c][g->inhand[c]];
+  }
+  if (g->state == WHITE) {
+    key ^= zobrist.side;
+  }
+  if (g->remove) {
+    key ^= zobrist.remove;
+  }
+  return key;
+}
+
+/* ********************************
+ * Queries
+ * ******************************** */
+
+/*
+ * Given coordinates such as `a1', retrieve the corresponding point, or
+ * NOPOINT if there is none. Assumes coords are lower case.
+ */
+int
+coordpoint(const game *g, const char *coords)
+{
+  return KERNEL(g)->coordpoint(coords);
+}
+
+/*
+ * Return the char corresponding to the contents of point p
+ */
+char
+pointchar(const game *g, const int p)
+{
+  if (g->bb[WHITE] & BIT(p)) {
+    return WHITEC;
+  } else if (g->bb[BLACK] & BIT(p)) {
+    return BLACKC;
+  }
+  return EMPTY;
+}
+
+/*
+ * Return the char corresponding to the current state
+ */
+char
+statechar(const game *g)
+{
+  return g->state == WHITE ? WHITEC : BLACKC;
+}
+
+/*
+ * Is the piece on point p in a mill?
+ */
+int
+inmill(const game *g, const int p)
+{
+  if (g->bb[WHITE] & BIT(p)) {
+    return KERNEL(g)->closesmill(g->bb[WHITE], p);
+  } else if (g->bb[BLACK] & BIT(p)) {
+    return KERNEL(g)->closesmill(g->bb[BLACK], p);
+  }
+  /* If we're EMPTY, we're clearly not in a mill */
+  return 0;
+}
+
+/*
+ * All of colour's pieces that are currently part of a mill
+ */
+bitboard
+millpieces(const game *g, const int colour)
+{
+  return KERNEL(g)->millpieces(g->bb[colour]);
+}
+
+/*
+ * Can the current player remove the piece on p after forming a mill?
+ * Pieces in mills may only be taken if every opponent piece is in one.
+ */
+int
+canremove(const game *g, const int p)
+{
+  return (KERNEL(g)->removable(g->bb[g->state ^ BLACK]) & BIT(p)) != 0;
+}
+
+/*
+ * Checks if the current player can slide to any adjacent position.
+ */
+int
+surrounded(const game *g)
+{
+  return g->f.mob[g->state] == 0;
+}
+
+/*
+ * Count g's features from scratch, for positions that weren't reached
+ * by makemove and to check those that were
+ */
+void
+countfeatures(const game *g, struct features *f)
+{
+  const struct topology *t = TOPO(g);
+  bitboard empty = EMPTIES(g);
+  bitboard b;
+  int c, k, n;
+
+  for (c = WHITE; c <= BLACK; c++) {
+    f->mob[c] = f->mills[c] = f->twos[c] = 0;
+    for (b = g->bb[c]; b; b &= b - 1) {
+      f->mob[c] += popcount(t->adj[lowbit(b)] & empty);
+    }
+    for (k = 0; k < t->nmills; k++) {
+      n = popcount(g->bb[c] & t->mills[k]);
+      f->mills[c] += n == 3;
+      f->twos[c] += n == 2 && (empty & t->mills[k]);
+    }
+  }
+}
+
+/*
+ * Die if g's features aren't what counting them gives. Called from
+ * makemove and the evaluation when built with -DCHECKFEATURES.
+ */
+void
+checkfeatures(const game *g)
+{
+  struct features f;
+  char buf[POSLEN];
+
+  countfeatures(g, &f);
+  if (memcmp(&f, &g->f, sizeof(f)) != 0) {
+    errx(1, "Features out of step in %s", fmtpos(g, buf));
+  }
+}
+
+/*
+ * Has the game been decided? Returns the winning colour, or NOCOLOUR
+ * while play continues. The player to move loses once they can no
+ * longer get three pieces on the board, or when they cannot move.
+ */
+int
+winner(const game *g)
+{
+  return KERNEL(g)->winner(g);
+}
+
+/* ********************************
+ * Move generation
+ * ******************************** */
+
+/*
+ * Store every legal move for the player to move in moves, which must
+ * have room for MAXMOVES, and return how many there are. Finished
+ * games have no moves.
+ */
+int
+genmoves(const game *g, move_t *moves)
+{
+  return KERNEL(g)->genmoves(g, moves);
+}
+
+/*
+ * Is m one of the moves genmoves would produce?
+ */
+int
+legalmove(const game *g, const move_t m)
+{
+  const struct topology *t = TOPO(g);
+  int s = g->state;
+  int from = MOVEFROM(m);
+  int to = MOVETO(m);
+
+  if (to >= t->npoints || from >= t->npoints) {
+    return 0;
+  }
+  if (MOVEKIND(m) == REMOVE) {
+    return g->remove && from == 0 && canremove(g, to);
+  }
+  if (g->remove || g->pieces[s] + g->inhand[s] < 3 ||
+      !(EMPTIES(g) & BIT(to))) {
+    return 0;
+  }
+  switch (MOVEKIND(m))
+  {
+  case PLACE:
+    return g->inhand[s] > 0 && from == 0;
+
+  case SLIDE:
+    return (!g->inhand[s] || t->moveinhand) && !FLIES(g, s) &&
+      (g->bb[s] & BIT(from)) && (t->adj[from] & BIT(to));
+
+  case JUMP:
+    return FLIES(g, s) && (g->bb[s] & BIT(from));
+
+  default:
+    return 0;
+  }
+}
+
+/* ********************************
+ * Updates
+ * ******************************** */
+
+/*
+ * Play the legal move m. If it closes a mill and the opponent has a
+ * piece on the board, the player keeps the move to make a removal.
+ */
+void
+makemove(game *g, const move_t m)
+{
+  KERNEL(g)->makemove(g, m);
+}
+
+/*
+ * Play m as makemove does, keeping in u what undomove needs to take
+ * it back
+ */
+void
+domove(game *g, const move_t m, struct undo *u)
+{
+  u->key = g->key;
+  u->f = g->f;
+  u->move = m;
+  u->state = g->state;
+  u->phase = g->phase;
+  u->remove = g->remove;
+  makemove(g, m);
+}
+
+/*
+ * Take back the move u was made for by domove. Only the pieces the
+ * move touched are put back; everything else is copied from u.
+ */
+void
+undomove(game *g, const struct undo *u)
+{
+  int s = u->state;
+  int to = MOVETO(u->move);
+
+  switch (MOVEKIND(u->move))
+  {
+  case PLACE:
+    g->bb[s] &= ~BIT(to);
+    g->inhand[s]++;
+    g->pieces[s]--;
+    break;
+
+  case SLIDE:
+  case JUMP:
+    g->bb[s] ^= BIT(MOVEFROM(u->move)) | BIT(to);
+    break;
+
+  case REMOVE:
+    g->bb[s ^ BLACK] |= BIT(to);
+    g->pieces[s ^ BLACK]++;
+    break;
+  }
+  g->key = u->key;
+  g->f = u->f;
+  g->state = s;
+  g->phase = u->phase;
+  g->remove = u->remove;
+}
+
+/*
+ * Play m in g and remember it in h, forgetting any moves that were
+ * taken back
+ */
+void
+pushmove(struct undostack *h, game *g, const move_t m)
+{
+  if (h->n == MAXUNDO) {
+    memmove(h->u, h->u + 1, (MAXUNDO - 1) * sizeof(h->u[0]));
+    h->n--;
+  }
+  domove(g, m, &h->u[h->n++]);
+  h->top = h->n;
+}
+
+/*
+ * Take back the last move played in g. Returns 0, or -1 if there's
+ * none left.
+ */
+int
+takeback(struct undostack *h, game *g)
+{
+  if (h->n == 0) {
+    return -1;
+  }
+  undomove(g, &h->u[--h->n]);
+  return 0;
+}
+
+/*
+ * Play again the last move taken back. Returns 0, or -1 if there's
+ * none.
+ */
+int
+redo(struct undostack *h, game *g)
+{
+  if (h->n == h->top) {
+    return -1;
+  }
+  domove(g, h->u[h->n].move, &h->u[h->n]);
+  h->n++;
+  return 0;
+}
+
+/* ********************************
+ * Notation
+ * ******************************** */
+
+/*
+ * Write m in the notation players type: `a1' to place, `d3s' to slide,
+ * `a1g7' to jump and `xa1' to remove. buf needs MOVELEN characters.
+ */
+char *
+fmtmove(const game *g, const move_t m, char *buf)
+{
+  const struct topology *t = TOPO(g);
+  int from = MOVEFROM(m);
+  int to = MOVETO(m);
+  int d;
+
+  switch (MOVEKIND(m))
+  {
+  case PLACE:
+    snprintf(buf, MOVELEN, "%s", t->names[to]);
+    break;
+
+  case SLIDE:
+    for (d = MINDIR; d < MAXDIR && t->nbr[from][d] != to; d++)
+      ;
+    snprintf(buf, MOVELEN, "%s%s", t->names[from], dirnames[d]);
+    break;
+
+  case JUMP:
+    snprintf(buf, MOVELEN, "%s%s", t->names[from], t->names[to]);
+    break;
+
+  case REMOVE:
+    snprintf(buf, MOVELEN, "x%s", t->names[to]);
+    break;
+
+  default:
+    snprintf(buf, MOVELEN, "-");
+  }
+  return buf;
+}
+
+/*
+ * Point named by the two characters at s, or NOPOINT
+ */
+static int
+readpoint(const game *g, const char *s)
+{
+  char coords[2];
+
+  if (!s[0]) {
+    return NOPOINT;
+  }
+  coords[0] = tolower((unsigned char)s[0]);
+  coords[1] = s[1];
+  return coordpoint(g, coords);
+}
+
+/*
+ * Read a move in the notation of fmtmove from the start of s, as it
+ * would be played in g. A slide may name its destination instead of a
+ * direction. A removal must have its `x': where pieces slide in phase
+ * 1, `a1d7' would otherwise be both a slide and a placement with its
+ * removal. Returns the number of characters read, or 0 if s does not
+ * start with a legal move.
+ */
+int
+parsemove(const game *g, const char *s, move_t *m)
+{
+  const struct topology *t = TOPO(g);
+  int from, to, d, len, c0, c1;
+  int s0 = g->state;
+
+  if (g->remove) {
+    if (s[0] != 'x' && s[0] != 'X') {
+      return 0;
+    }
+    *m = MOVE(REMOVE, 0, to = readpoint(g, s + 1));
+    return to != NOPOINT && legalmove(g, *m) ? 3 : 0;
+  }
+  if ((from = readpoint(g, s)) == NOPOINT) {
+    return 0;
+  }
+  if (g->inhand[s0] && !t->moveinhand) {
+    *m = MOVE(PLACE, 0, from);
+    return legalmove(g, *m) ? 2 : 0;
+  }
+  if ((to = readpoint(g, s + 2)) != NOPOINT) {
+    len = 4;
+  } else {
+    /* Try the two letter directions first. Replaying archives spends
+       much of its time here, so the letters are compared directly. */
+    c0 = tolower((unsigned char)s[2]);
+    c1 = c0 ? tolower((unsigned char)s[3]) : '\0';
+    for (len = 2, d = MAXDIR; d >= MINDIR; d--) {
+      if (dirnames[d][0] == c0 &&
+	  (!dirnames[d][1] || dirnames[d][1] == c1)) {
+	to = t->nbr[from][d];
+	len += dirnames[d][1] ? 2 : 1;
+	break;
+      }
+    }
+    if (len == 2 && g->inhand[s0]) {
+      /* Neither follows the point, so it's a placement */
+      *m = MOVE(PLACE, 0, from);
+      return legalmove(g, *m) ? 2 : 0;
+    }
+    if (to == NOPOINT) {
+      return 0;
+    }
+  }
+  *m = MOVE(FLIES(g, s0) ? JUMP : SLIDE, from, to);
+  return legalmove(g, *m) ? len : 0;
+}
+
+/*
+ * Write g as a position string: the game's name, the points in column
+ * order (a1, a4, a7, b2, ...) as E, W or B, the player to move (b or
+ * w, followed by x if they have a piece to remove), and the number of
+ * pieces White and Black have yet to place. For example,
+ *
+ *   nmm EEEEEEEEEEEEEEEEEEEEEEEE b 9 9
+ *
+ * buf needs POSLEN characters.
+ */
+char *
+fmtpos(const game *g, char *buf)
+{
+  const struct topology *t = TOPO(g);
+  char *s = buf;
+  int c, r;
+
+  s += sprintf(s, "%s ", t->name);
+  for (c = 0; c < t->side; c++) {
+    for (r = 0; r < t->side; r++) {
+      if (t->at[c][r] != NOPOINT) {
+	*s++ = pointchar(g, t->at[c][r]);
+      }
+    }
+  }
+  sprintf(s, " %c%s %d %d", g->state == WHITE ? 'w' : 'b',
+	  g->remove ? "x" : "", g->inhand[WHITE], g->inhand[BLACK]);
+  return buf;
+}
+
+/*
+ * Set g from a position string written by fmtpos. Returns 0 on
+ * success and -1, leaving g untouched, if the string makes no sense.
+ */
+int
+parsepos(game *g, const char *s)
+{
+  const struct topology *t;
+  char name[sizeof(t->name)], board[MAXPOINTS + 2], side[3];
+  int type, c, r, i, wh, bh, n;
+  game new;
+
+  if (sscanf(s, "%7s %25s %2s %d %d%n", name, board, side,
+	     &wh, &bh, &n) != 5) {
+    return -1;
+  }
+  for (s += n; *s; s++) {
+    /* Nothing may follow but blanks */
+    if (!isspace((unsigned char)*s)) {
+      return -1;
+    }
+  }
+  for (type = 0; type < NVARIANTS; type++) {
+    if (strcmp(name, topo[type].name) == 0) {
+      break;
+    }
+  }
+  if (type == NVARIANTS) {
+    return -1;
+  }
+  initgame(&new, type);
+  t = TOPO(&new);
+  if ((int)strlen(board) != t->npoints) {
+    return -1;
+  }
+  for (i = 0, c = 0; c < t->side; c++) {
+    for (r = 0; r < t->side; r++) {
+      if (t->at[c][r] == NOPOINT) {
+	continue;
+      }
+      switch (toupper((unsigned char)board[i++]))
+      {
+      case WHITEC:
+	new.bb[WHITE] |= BIT(t->at[c][r]);
+	break;
+
+      case BLACKC:
+	new.bb[BLACK] |= BIT(t->at[c][r]);
+	break;
+
+      case EMPTY:
+	break;
+
+      default:
+	return -1;
+      }
+    }
+  }
+  switch (tolower((unsigned char)side[0]))
+  {
+  case 'w':
+    new.state = WHITE;
+    break;
+
+  case 'b':
+    new.state = BLACK;
+    break;
+
+  default:
+    return -1;
+  }
+  new.remove = (tolower((unsigned char)side[1]) == 'x');
+  if ((side[1] && !new.remove) || (new.remove && !new.bb[new.state ^ BLACK])) {
+    return -1;
+  }
+  new.pieces[WHITE] = popcount(new.bb[WHITE]);
+  new.pieces[BLACK] = popcount(new.bb[BLACK]);
+  if (wh < 0 || bh < 0 || new.pieces[WHITE] + wh > t->npieces ||
+      new.pieces[BLACK] + bh > t->npieces) {
+    return -1;
+  }
+  new.inhand[WHITE] = wh;
+  new.inhand[BLACK] = bh;
+  KERNEL(&new)->setphase(&new);
+  countfeatures(&new, &new.f);
+  new.key = hashgame(&new);
+  *g = new;
+  return 0;
+}
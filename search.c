@@ -0,0 +1,669 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The computer player: a negamax alpha-beta search with iterative
+ * deepening. A removal is a move by the player who just closed the
+ * mill, so the score is only negated when the move passes to the
+ * other player.
+ *
+ * With more than one thread we use "lazy SMP": helper threads search
+ * the same root independently, a ply deeper than the main thread or in
+ * a different order, and help only by filling the shared hash table.
+ * The main thread alone decides when to stop and what to play.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+#define CHECKNODES 1023	/* look at the clock this often */
+#define MAXHISTORY (1 << 24)	/* history scores are halved past this */
+
+/* Order of moves, best first, before history counts */
+#define HASHMOVE (1 << 30)
+#define MILLMOVE (1 << 29)
+#define KILLER (1 << 28)
+#define BLOCKMOVE (1 << 27)
+#define THREAT (1 << 25)	/* for each mill a removal spoils or opens */
+
+static int	 negamax(struct search *, const game *, int, const int,
+			 int, const int);
+static int	 outoftime(struct search *);
+static int	 tott(const int, const int);
+static int	 fromtt(const int, const int);
+static int	 egscore(const int, const int);
+static int	 closesmill(const struct search *, const game *,
+			    const move_t);
+static int	 blocksmill(const struct search *, const game *,
+			    const move_t);
+static int	 threats(const game *, const int);
+static void	 ordermoves(const struct search *, const game *,
+			    const move_t *, const int, const move_t,
+			    const int, int *);
+static move_t	 pickmove(move_t *, int *, const int, const int);
+static void	 goodmove(struct search *, const game *, const move_t,
+			  const int, const int);
+static void	 iterate(struct search *);
+static void	*helper(void *);
+static void	 sumnodes(struct search *);
+static void	 report(const struct search *);
+
+/*
+ * Score g from the point of view of the player to move, from its
+ * material, its mobility once it has to slide, and its mills closed
+ * and threatened. makemove keeps count of the last three, so this
+ * doesn't look at the board.
+ */
+int
+evaluate(const game *g)
+{
+  int s = g->state;
+  int o = s ^ BLACK;
+  int score, mob[2], c;
+
+#if defined(CHECKFEATURES)
+  checkfeatures(g);
+#endif
+  score = 100 * (g->pieces[s] + g->inhand[s] - g->pieces[o] - g->inhand[o]);
+  if (g->remove) {
+    /* As good as a piece already */
+    score += 100;
+  }
+  for (c = WHITE; c <= BLACK; c++) {
+    /* Mobility only counts for a player who has to slide */
+    mob[c] = !g->inhand[c] && !FLIES(g, c) ? g->f.mob[c] : 0;
+  }
+  score += 5 * (mob[s] - mob[o]);
+  score += 30 * (g->f.mills[s] - g->f.mills[o]);
+  score += 10 * (g->f.twos[s] - g->f.twos[o]);
+  return score;
+}
+
+/*
+ * Set up a search from g with the default limits: no limit on depth
+ * or nodes, and one second of thinking
+ */
+void
+initsearch(struct search *s, const game *g)
+{
+  memset(s, 0, sizeof(*s));
+  s->root = *g;
+  s->maxdepth = MAXPLY - 1;
+  s->maxtime = 1.0;
+  s->nthreads = 1;
+}
+
+/*
+ * Should we give up? The node budget is kept to the node, but the
+ * clock is only looked at every so often.
+ */
+static int
+outoftime(struct search *s)
+{
+  if (s->stop) {
+    return 1;
+  }
+  if ((s->nodes & CHECKNODES) == 0 &&
+      s->maxtime > 0 && walltime() >= s->deadline) {
+    s->stop = 1;
+  }
+  return s->stop;
+}
+
+/*
+ * Wins and losses are stored in the table as distances from the
+ * position itself rather than from the root
+ */
+static int
+tott(const int score, const int ply)
+{
+  if (score >= WIN - MAXWIN) {
+    return score + ply;
+  } else if (score <= -WIN + MAXWIN) {
+    return score - ply;
+  }
+  return score;
+}
+
+static int
+fromtt(const int score, const int ply)
+{
+  if (score >= WIN - MAXWIN) {
+    return score - ply;
+  } else if (score <= -WIN + MAXWIN) {
+    return score + ply;
+  }
+  return score;
+}
+
+/*
+ * The score of a position ply plies from the root that the endgame
+ * database says is decided v
+ */
+static int
+egscore(const int v, const int ply)
+{
+  if (EGISWIN(v)) {
+    return WIN - ply - EGDIST(v);
+  } else if (EGISLOSS(v)) {
+    return -WIN + ply + EGDIST(v);
+  }
+  return 0;
+}
+
+/* ****
+ * Move ordering
+ * **** */
+
+/*
+ * Does m complete a mill of the player making it?
+ */
+static int
+closesmill(const struct search *s, const game *g, const move_t m)
+{
+  bitboard own = g->bb[g->state];
+
+  if (MOVEKIND(m) == SLIDE || MOVEKIND(m) == JUMP) {
+    own &= ~BIT(MOVEFROM(m));
+  }
+  return s->k->closesmill(own, MOVETO(m));
+}
+
+/*
+ * Does m take the point where the opponent would complete a mill?
+ */
+static int
+blocksmill(const struct search *s, const game *g, const move_t m)
+{
+  return s->k->closesmill(g->bb[g->state ^ BLACK], MOVETO(m));
+}
+
+/*
+ * How many mills removing the opponent's piece at p spoils for them,
+ * lines where they have one more piece and a point free, or opens for
+ * us, lines where we have the other two points
+ */
+static int
+threats(const game *g, const int p)
+{
+  const struct topology *t = TOPO(g);
+  bitboard own = g->bb[g->state], opp = g->bb[g->state ^ BLACK];
+  bitboard empty = EMPTIES(g), l;
+  int k, n = 0;
+
+  for (k = 0; k < t->npmills[p]; k++) {
+    l = t->pmills[p][k];
+    n += (own & l) == l ||
+      (popcount(opp & l) == 1 && popcount(empty & l) == 1);
+  }
+  return n;
+}
+
+/*
+ * Give each of the n moves at g an order: the move from the hash table
+ * first, then those that close a mill, the killers, those that stop a
+ * mill, and the rest by how often they have cut off elsewhere.
+ * Removals go by how many mills they spoil or open, then by history.
+ */
+static void
+ordermoves(const struct search *s, const game *g, const move_t *moves,
+	   const int n, const move_t hashmove, const int ply, int *order)
+{
+  int i, side = g->state, m;
+
+  for (i = 0; i < n; i++) {
+    m = moves[i];
+    if (m == hashmove) {
+      order[i] = HASHMOVE;
+    } else if (MOVEKIND(m) == REMOVE) {
+      order[i] = THREAT * threats(g, MOVETO(m)) +
+	s->rhistory[side][MOVETO(m)];
+    } else if (closesmill(s, g, m)) {
+      order[i] = MILLMOVE;
+    } else if (m == s->killers[ply][0]) {
+      order[i] = KILLER + 1;
+    } else if (m == s->killers[ply][1]) {
+      order[i] = KILLER;
+    } else if (blocksmill(s, g, m)) {
+      order[i] = BLOCKMOVE;
+    } else {
+      order[i] = s->history[side][MOVEKIND(m) == PLACE ? MAXPOINTS :
+				  MOVEFROM(m)][MOVETO(m)];
+    }
+  }
+}
+
+/*
+ * Bring the best of moves i to n - 1 to the front of them and return
+ * it. Sorting as we go saves sorting moves a cutoff means we never
+ * try.
+ */
+static move_t
+pickmove(move_t *moves, int *order, const int n, const int i)
+{
+  int j, best = i, o;
+  move_t m;
+
+  for (j = i + 1; j < n; j++) {
+    if (order[j] > order[best]) {
+      best = j;
+    }
+  }
+  m = moves[best];
+  moves[best] = moves[i];
+  moves[i] = m;
+  o = order[best];
+  order[best] = order[i];
+  order[i] = o;
+  return m;
+}
+
+/*
+ * Remember m, which cut off at g, depth plies from the horizon. Mills
+ * are tried early anyway, so only quiet moves become killers.
+ */
+static void
+goodmove(struct search *s, const game *g, const move_t m, const int depth,
+	 const int ply)
+{
+  uint32_t *h;
+  int side = g->state, i, j;
+
+  if (MOVEKIND(m) == REMOVE) {
+    h = &s->rhistory[side][MOVETO(m)];
+  } else if (closesmill(s, g, m)) {
+    return;
+  } else {
+    if (s->killers[ply][0] != m) {
+      s->killers[ply][1] = s->killers[ply][0];
+      s->killers[ply][0] = m;
+    }
+    h = &s->history[side][MOVEKIND(m) == PLACE ? MAXPOINTS :
+			  MOVEFROM(m)][MOVETO(m)];
+  }
+  if ((*h += depth * depth) > MAXHISTORY) {
+    /* Let old successes fade rather than overflow */
+    for (i = 0; i <= MAXPOINTS; i++) {
+      for (j = 0; j < MAXPOINTS; j++) {
+	s->history[side][i][j] /= 2;
+      }
+    }
+    for (j = 0; j < MAXPOINTS; j++) {
+      s->rhistory[side][j] /= 2;
+    }
+  }
+}
+
+/* ****
+ * Searching
+ * **** */
+
+/*
+ * Search g to depth plies, returning its score for the player to
+ * move. Closing a mill doesn't use up depth, so we never stop with
+ * a removal pending.
+ */
+static int
+negamax(struct search *s, const game *g, int depth, const int ply,
+	int alpha, const int beta)
+{
+  move_t moves[MAXMOVES];
+  move_t hashmove = NOMOVE, bestmove = NOMOVE, m;
+  struct ttentry e;
+  game c;
+  int order[MAXMOVES];
+  int i, n, v, score, best, oldalpha = alpha;
+
+  s->nodes++;
+  if (s->maxnodes && s->nodes >= s->maxnodes) {
+    s->stop = 1;
+  }
+  s->pvlen[ply] = ply;
+  if (s->k->winner(g) != NOCOLOUR) {
+    return -WIN + ply;
+  }
+  if (s->egdb && (v = egprobe(s->egdb, g)) != -1) {
+    return egscore(v, ply);
+  }
+  if (depth <= 0 || ply >= MAXPLY - 1) {
+    return evaluate(g);
+  }
+  if (outoftime(s)) {
+    return 0;
+  }
+  if (s->tt && ttprobe(s->tt, g->key, &e)) {
+    hashmove = e.move;
+    if (e.depth >= depth) {
+      score = fromtt(e.score, ply);
+      if (e.bound == EXACT ||
+	  (e.bound == LOWER && score >= beta) ||
+	  (e.bound == UPPER && score <= alpha)) {
+	return score;
+      }
+    }
+  }
+  n = s->k->genmoves(g, moves);
+  ordermoves(s, g, moves, n, hashmove, ply, order);
+  best = -INFINITE;
+  for (i = 0; i < n; i++) {
+    m = pickmove(moves, order, n, i);
+    c = *g;
+    s->k->makemove(&c, m);
+    if (c.state == g->state) {
+      score = negamax(s, &c, depth, ply + 1, alpha, beta);
+    } else {
+      score = -negamax(s, &c, depth - 1, ply + 1, -beta, -alpha);
+    }
+    if (s->stop) {
+      return 0;
+    }
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+	alpha = score;
+	bestmove = m;
+	s->pv[ply][ply] = m;
+	memcpy(&s->pv[ply][ply + 1], &s->pv[ply + 1][ply + 1],
+	       (s->pvlen[ply + 1] - ply - 1) * sizeof(move_t));
+	s->pvlen[ply] = s->pvlen[ply + 1];
+	if (score >= beta) {
+	  s->cutoffs++;
+	  s->firstcutoffs += (i == 0);
+	  goodmove(s, g, m, depth, ply);
+	  break;
+	}
+      }
+    }
+  }
+  if (s->tt) {
+    ttstore(s->tt, g->key, depth,
+	    best >= beta ? LOWER : best > oldalpha ? EXACT : UPPER,
+	    tott(best, ply), bestmove);
+  }
+  return best;
+}
+
+/*
+ * Search the root position a ply deeper at a time until we hit one
+ * of the limits. The best move, its score, the depth and principal
+ * variation of the last completed iteration are left in s.
+ */
+static void
+iterate(struct search *s)
+{
+  move_t moves[MAXMOVES];
+  move_t bestmove;
+  game c;
+  int depth, i, n, score, alpha;
+
+  s->k = KERNEL(&s->root);
+  n = s->k->genmoves(&s->root, moves);
+  /* Helpers start at different moves, and odd ones a ply deeper */
+  for (i = 0; i < s->id % n; i++) {
+    bestmove = moves[0];
+    memmove(&moves[0], &moves[1], (n - 1) * sizeof(move_t));
+    moves[n - 1] = bestmove;
+  }
+  s->best = moves[0];
+  for (depth = 1 + (s->id & 1); depth <= s->maxdepth; depth++) {
+    alpha = -INFINITE;
+    bestmove = NOMOVE;
+    for (i = 0; i < n; i++) {
+      c = s->root;
+      s->k->makemove(&c, moves[i]);
+      if (c.state == s->root.state) {
+	score = negamax(s, &c, depth, 1, alpha, INFINITE);
+      } else {
+	score = -negamax(s, &c, depth - 1, 1, -INFINITE, -alpha);
+      }
+      if (s->stop) {
+	break;
+      }
+      if (score > alpha) {
+	alpha = score;
+	bestmove = moves[i];
+	s->pv[0][0] = moves[i];
+	memcpy(&s->pv[0][1], &s->pv[1][1],
+	       (s->pvlen[1] - 1) * sizeof(move_t));
+	s->pvlen[0] = s->pvlen[1];
+      }
+    }
+    if (s->stop) {
+      break;
+    }
+    /* Search the best move first next time round */
+    for (i = 0; moves[i] != bestmove; i++)
+      ;
+    memmove(&moves[1], &moves[0], i * sizeof(move_t));
+    moves[0] = bestmove;
+    s->best = bestmove;
+    s->score = alpha;
+    s->depth = depth;
+    s->npv = s->pvlen[0];
+    memcpy(s->bestpv, s->pv[0], s->npv * sizeof(move_t));
+    if (s->tt) {
+      ttstore(s->tt, s->root.key, depth, EXACT, alpha, bestmove);
+    }
+    if (s->report) {
+      s->elapsed = walltime() - s->start;
+      sumnodes(s);
+      s->report(s);
+    }
+    if (DECIDED(alpha)) {
+      /* Forced win or loss found, deeper won't change our mind */
+      break;
+    }
+  }
+}
+
+static void *
+helper(void *arg)
+{
+  iterate(arg);
+  return NULL;
+}
+
+/*
+ * Add up the nodes searched, and the cutoffs, by each thread so far.
+ * The helpers' counts are read while they run, so they may be a little
+ * behind.
+ */
+static void
+sumnodes(struct search *s)
+{
+  int i;
+
+  s->threadnodes[0] = s->nodes;
+  s->totalnodes = s->nodes;
+  s->totalcutoffs = s->cutoffs;
+  s->totalfirst = s->firstcutoffs;
+  for (i = 1; i < s->nthreads; i++) {
+    s->threadnodes[i] = s->helpers[i - 1].nodes;
+    s->totalnodes += s->threadnodes[i];
+    s->totalcutoffs += s->helpers[i - 1].cutoffs;
+    s->totalfirst += s->helpers[i - 1].firstcutoffs;
+  }
+}
+
+/*
+ * Search the root position with s->nthreads threads until we hit one
+ * of the limits. Returns the best move, or NOMOVE if the game is over.
+ * While pieces are being placed, a move from s->book is played without
+ * searching. Setting s->stop from another thread stops it early, even
+ * before it starts; initsearch clears it.
+ */
+move_t
+think(struct search *s)
+{
+  move_t moves[MAXMOVES];
+  pthread_t tid[MAXTHREADS];
+  struct search *h;
+  int i;
+
+  s->nodes = 0;
+  s->cutoffs = 0;
+  s->firstcutoffs = 0;
+  s->id = 0;
+  if (s->tt) {
+    ttnewsearch(s->tt);
+  }
+  s->start = walltime();
+  s->deadline = s->start + s->maxtime;
+  s->best = NOMOVE;
+  s->depth = 0;
+  s->npv = 0;
+  if (genmoves(&s->root, moves) == 0) {
+    return NOMOVE;
+  }
+  if (s->book && s->root.phase == 1 &&
+      (s->best = bookprobe(s->book, &s->root)) != NOMOVE) {
+    s->npv = 1;
+    s->bestpv[0] = s->best;
+    s->elapsed = walltime() - s->start;
+    return s->best;
+  }
+  if (s->nthreads < 1) {
+    s->nthreads = 1;
+  } else if (s->nthreads > MAXTHREADS) {
+    s->nthreads = MAXTHREADS;
+  }
+  s->helpers = NULL;
+  if (s->nthreads > 1) {
+    if (!(s->helpers = calloc(s->nthreads - 1, sizeof(struct search)))) {
+      err(1, "Unable to allocate search threads");
+    }
+    for (i = 1; i < s->nthreads; i++) {
+      /* Helpers only stop when we tell them to */
+      h = &s->helpers[i - 1];
+      initsearch(h, &s->root);
+      h->maxtime = 0;
+      h->tt = s->tt;
+      h->egdb = s->egdb;
+      h->id = i;
+      h->start = s->start;
+      if (pthread_create(&tid[i], NULL, helper, h) != 0) {
+	err(1, "Unable to start search thread");
+      }
+    }
+  }
+  iterate(s);
+  for (i = 1; i < s->nthreads; i++) {
+    s->helpers[i - 1].stop = 1;
+  }
+  for (i = 1; i < s->nthreads; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  s->elapsed = walltime() - s->start;
+  sumnodes(s);
+  free(s->helpers);
+  s->helpers = NULL;
+  return s->best;
+}
+
+/*
+ * Write score for people: `cp' and the score, or `win' or `loss' and
+ * the plies to go. buf needs SCORELEN characters.
+ */
+char *
+fmtscore(const int score, char *buf)
+{
+  if (DECIDED(score)) {
+    snprintf(buf, SCORELEN, "%s %d", score > 0 ? "win" : "loss",
+	     WIN - abs(score));
+  } else {
+    snprintf(buf, SCORELEN, "cp %d", score);
+  }
+  return buf;
+}
+
+/*
+ * Write out the principal variation of the last iteration, separated
+ * by spaces, into buf of size len
+ */
+char *
+fmtpv(const struct search *s, char *buf, const size_t len)
+{
+  char mbuf[MOVELEN];
+  game g = s->root;
+  size_t n = 0;
+  int i;
+
+  buf[0] = '\0';
+  for (i = 0; i < s->npv && n < len; i++) {
+    n += snprintf(buf + n, len - n, "%s%s", i ? " " : "",
+		  fmtmove(&g, s->bestpv[i], mbuf));
+    makemove(&g, s->bestpv[i]);
+  }
+  return buf;
+}
+
+/*
+ * Print a line about an iteration that has just finished
+ */
+static void
+report(const struct search *s)
+{
+  char buf[MAXPLY * MOVELEN];
+
+  printf("depth %d score %d nodes %llu nps %.0f time %.3f pv %s\n",
+	 s->depth, s->score, (unsigned long long)s->totalnodes,
+	 s->elapsed > 0 ? s->totalnodes / s->elapsed : 0.0, s->elapsed,
+	 fmtpv(s, buf, sizeof(buf)));
+  fflush(stdout);
+}
+
+/*
+ * Search the root of s as set up by the caller, printing each
+ * iteration and then how much of the work each thread did
+ */
+void
+analyse(struct search *s)
+{
+  char buf[POSLEN];
+  int i;
+
+  printf("%s\n", fmtpos(&s->root, buf));
+  s->report = report;
+  think(s);
+  for (i = 0; i < s->nthreads; i++) {
+    printf("thread %d: %llu nodes (%.1f%%)\n", i,
+	   (unsigned long long)s->threadnodes[i],
+	   s->totalnodes ? 100.0 * s->threadnodes[i] / s->totalnodes : 0.0);
+  }
+  printf("cutoffs %llu, %.1f%% on the first move\n",
+	 (unsigned long long)s->totalcutoffs,
+	 s->totalcutoffs ? 100.0 * s->totalfirst / s->totalcutoffs : 0.0);
+  printf("bestmove %s: %llu nodes in %.3f s (%.0f nodes/s, %d threads)\n",
+	 s->best == NOMOVE ? "none" : fmtmove(&s->root, s->best, buf),
+	 (unsigned long long)s->totalnodes, s->elapsed,
+	 s->elapsed > 0 ? s->totalnodes / s->elapsed : 0.0, s->nthreads);
+}
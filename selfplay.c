@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Play the computer against itself without a terminal, many games at
+ * once, for testing changes to the search and for collecting games.
+ * Each thread plays whole games, taking the next one to play from a
+ * shared counter, and has a transposition table of its own for each
+ * side so that neither learns from the other's searches. The random
+ * opening moves of each game come from a generator seeded with the
+ * game's number, so a run can be repeated.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+struct pool {
+  const struct selfplay *sp;
+  pthread_mutex_t lock;		/* guards next and stdout */
+  int		 next;		/* the next game to be played */
+  int		*length;	/* plies in each game */
+  signed char	*result;	/* winner of each game, or NOCOLOUR */
+};
+
+struct player {
+  pthread_t	 tid;
+  struct pool	*pool;
+  struct search	*s;
+  struct tt	 tt[2];
+  move_t	*moves;		/* the moves of the game being played */
+  uint64_t	*keys;		/* and the positions it went through */
+  uint64_t	 nodes;
+};
+
+static uint64_t	 nextrandom(uint64_t *);
+static int	 play(struct player *, const int);
+static void	*playgames(void *);
+static int	 intcmp(const void *, const void *);
+
+/*
+ * splitmix64
+ */
+static uint64_t
+nextrandom(uint64_t *x)
+{
+  uint64_t z;
+
+  z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/*
+ * Play game number n to the end, or until it's too long or the same
+ * position comes round a third time and it counts as a draw. Returns
+ * the winner, or NOCOLOUR.
+ */
+static int
+play(struct player *p, const int n)
+{
+  const struct selfplay *sp = p->pool->sp;
+  const struct engine *e;
+  move_t moves[MAXMOVES];
+  uint64_t x = sp->seed ^ (uint64_t)n * 0xd1342543de82ef95ULL;
+  struct recwriter wr;
+  struct record rec;
+  game g = sp->start;
+  int i, nmoves, plies, reps, since = 0, w;
+  move_t m;
+
+  ttclear(&p->tt[WHITE]);
+  ttclear(&p->tt[BLACK]);
+  for (plies = 0; (w = winner(&g)) == NOCOLOUR; plies++) {
+    if (plies == sp->maxplies) {
+      break;
+    }
+    /* Only slides and jumps can be undone, so look back to the last
+       placement or removal */
+    for (reps = 0, i = since; i < plies; i++) {
+      reps += p->keys[i] == g.key;
+    }
+    if (reps == 2) {
+      break;
+    }
+    p->keys[plies] = g.key;
+    e = &sp->side[g.state];
+    if (plies < sp->randomplies || e->depth == 0) {
+      if ((nmoves = genmoves(&g, moves)) == 0) {
+	w = g.state ^ BLACK;
+	break;
+      }
+      m = moves[nextrandom(&x) % nmoves];
+    } else {
+      initsearch(p->s, &g);
+      p->s->maxdepth = e->depth;
+      p->s->maxtime = e->maxtime;
+      p->s->tt = &p->tt[g.state];
+      p->s->egdb = sp->egdb;
+      p->s->book = sp->book;
+      m = think(p->s);
+      p->nodes += p->s->nodes;
+      if (m == NOMOVE) {
+	w = g.state ^ BLACK;
+	break;
+      }
+    }
+    p->moves[plies] = m;
+    if (MOVEKIND(m) == PLACE || MOVEKIND(m) == REMOVE) {
+      since = plies + 1;
+    }
+    makemove(&g, m);
+  }
+  p->pool->length[n] = plies;
+  p->pool->result[n] = w;
+  if (sp->verbose) {
+    rec.start = sp->start;
+    rec.result = w;
+    rec.ntags = 3;
+    strcpy(rec.tags[0].name, "Round");
+    snprintf(rec.tags[0].value, TAGLEN, "%d", n + 1);
+    for (i = WHITE; i <= BLACK; i++) {
+      e = &sp->side[i];
+      strcpy(rec.tags[1 + i].name, i == WHITE ? "White" : "Black");
+      if (e->depth == 0) {
+	strcpy(rec.tags[1 + i].value, "random");
+      } else if (e->maxtime > 0) {
+	snprintf(rec.tags[1 + i].value, TAGLEN, "nmm -t %g", e->maxtime);
+      } else {
+	snprintf(rec.tags[1 + i].value, TAGLEN, "nmm -D %d", e->depth);
+      }
+    }
+    pthread_mutex_lock(&p->pool->lock);
+    wrbegin(&wr, stdout, &rec);
+    for (i = 0; i < plies; i++) {
+      wrmove(&wr, p->moves[i]);
+    }
+    wrend(&wr, w);
+    pthread_mutex_unlock(&p->pool->lock);
+  }
+  return w;
+}
+
+/*
+ * Play games until there are none left
+ */
+static void *
+playgames(void *arg)
+{
+  struct player *p = arg;
+  struct pool *pool = p->pool;
+  int n;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    n = pool->next < pool->sp->ngames ? pool->next++ : -1;
+    pthread_mutex_unlock(&pool->lock);
+    if (n < 0) {
+      return NULL;
+    }
+    play(p, n);
+  }
+}
+
+static int
+intcmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Play sp->ngames games over sp->nthreads threads, then report who
+ * won, how long the games were and how fast they went. With
+ * sp->verbose, the games go to stdout and the report to stderr, so
+ * that the games can be piped to mkbook.
+ */
+void
+runselfplay(const struct selfplay *sp)
+{
+  FILE *out = sp->verbose ? stderr : stdout;
+  struct pool pool;
+  struct player *p;
+  uint64_t nodes = 0;
+  uint64_t plies = 0;
+  double start, secs;
+  int i, nthreads = sp->nthreads, wins[2] = { 0, 0 }, draws = 0;
+
+  if (nthreads < 1) {
+    nthreads = 1;
+  } else if (nthreads > sp->ngames) {
+    nthreads = sp->ngames > 0 ? sp->ngames : 1;
+  }
+  pool.sp = sp;
+  pool.next = 0;
+  pthread_mutex_init(&pool.lock, NULL);
+  if (!(pool.length = calloc(sp->ngames + 1, sizeof(*pool.length))) ||
+      !(pool.result = calloc(sp->ngames + 1, sizeof(*pool.result))) ||
+      !(p = calloc(nthreads, sizeof(*p)))) {
+    err(1, "Unable to allocate the games");
+  }
+  for (i = 0; i < nthreads; i++) {
+    p[i].pool = &pool;
+    if (!(p[i].s = malloc(sizeof(*p[i].s))) ||
+	!(p[i].moves = malloc(sp->maxplies * sizeof(*p[i].moves))) ||
+	!(p[i].keys = malloc(sp->maxplies * sizeof(*p[i].keys)))) {
+      err(1, "Unable to allocate the players");
+    }
+    if (ttinit(&p[i].tt[WHITE], sp->hashmb) == -1 ||
+	ttinit(&p[i].tt[BLACK], sp->hashmb) == -1) {
+      err(1, "Unable to allocate the hash tables");
+    }
+  }
+  start = walltime();
+  for (i = 1; i < nthreads; i++) {
+    if (pthread_create(&p[i].tid, NULL, playgames, &p[i]) != 0) {
+      err(1, "Unable to start self-play thread");
+    }
+  }
+  playgames(&p[0]);
+  for (i = 1; i < nthreads; i++) {
+    pthread_join(p[i].tid, NULL);
+  }
+  secs = walltime() - start;
+  for (i = 0; i < sp->ngames; i++) {
+    if (pool.result[i] == NOCOLOUR) {
+      draws++;
+    } else {
+      wins[(int)pool.result[i]]++;
+    }
+    plies += pool.length[i];
+  }
+  for (i = 0; i < nthreads; i++) {
+    nodes += p[i].nodes;
+    ttfree(&p[i].tt[WHITE]);
+    ttfree(&p[i].tt[BLACK]);
+    free(p[i].s);
+    free(p[i].moves);
+    free(p[i].keys);
+  }
+  qsort(pool.length, sp->ngames, sizeof(*pool.length), intcmp);
+  fprintf(out, "games %d in %.3f s (%.1f games/s, %d thread%s)\n",
+	  sp->ngames, secs, secs > 0 ? sp->ngames / secs : 0.0, nthreads,
+	  nthreads == 1 ? "" : "s");
+  if (sp->ngames > 0) {
+    fprintf(out, "white %d (%.1f%%) black %d (%.1f%%) draw %d (%.1f%%)\n",
+	    wins[WHITE], 100.0 * wins[WHITE] / sp->ngames,
+	    wins[BLACK], 100.0 * wins[BLACK] / sp->ngames,
+	    draws, 100.0 * draws / sp->ngames);
+    fprintf(out, "plies min %d median %d mean %.1f max %d\n",
+	    pool.length[0], pool.length[sp->ngames / 2],
+	    (double)plies / sp->ngames, pool.length[sp->ngames - 1]);
+  }
+  fprintf(out, "nodes %llu (%.0f nodes/s)\n", (unsigned long long)nodes,
+	  secs > 0 ? nodes / secs : 0.0);
+  pthread_mutex_destroy(&pool.lock);
+  free(pool.length);
+  free(pool.result);
+  free(p);
+}
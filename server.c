@@ -0,0 +1,745 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Server mode: many games at once between clients of a Unix domain
+ * socket, all in one thread. Each client sends lines of words and is
+ * answered the same way:
+ *
+ *   new [<game>]		open a game and sit at it as Black;
+ *				answered with game <id> black
+ *   join <id>			sit at game id's empty seat; answered
+ *				with game <id> <colour>, and both
+ *				players then get start <id> <position>
+ *   observe <id>		watch game id; answered with observing
+ *				<id> <position>
+ *   move <move> ...		play moves in the game, in turn
+ *   show			answered with position <id> <position>
+ *   leave			stand up from the game or stop watching
+ *   quit
+ *
+ * Everyone at a game, players and watchers alike, gets moved <id>
+ * <move> for each move played in it, over <id> <result> when it's won,
+ * and left <id> <colour> when a player stands up. Problems are reported
+ * on an error line.
+ *
+ * The event loop waits on epoll, and a client that's idle costs a few
+ * hundred bytes of buffers and nothing else. Replies are written
+ * straight away; what the socket won't take is queued until it's
+ * writable again, and a client that lets the queue fill is dropped.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SEPS " \t\r\n"
+#define INLEN 128		/* longest line read, with its newline */
+#define OUTLEN 1024		/* most written and not yet taken */
+#define MAXEVENTS 256
+#define RETRYMS 1000		/* to wait out a lack of descriptors */
+#define WATCHING 2		/* the seat of a client watching a game */
+
+struct client {
+  int		 table;		/* game at, or -1 */
+  int		 seat;		/* WHITE, BLACK or WATCHING */
+  int		 next;		/* fd of the next watcher of the game, */
+  int		 prev;		/* and of the one before, or -1 */
+  int		 nextdead;	/* fd of the next client to close, or -1 */
+  int		 dead;
+  int		 waiting;	/* for the socket to be writable */
+  unsigned short inlen;
+  unsigned short outlen;
+  char		 in[INLEN];
+  char		 out[OUTLEN];
+};
+
+struct table {
+  game		 g;
+  int		 seat[2];	/* fd of each player, or -1 */
+  int		 watchers;	/* fd of the first watcher, or -1 */
+  int		 started;	/* both players have sat down */
+  int		 inuse;
+};
+
+struct server {
+  int		 epfd;
+  int		 lfd;		/* the listening socket */
+  int		 listening;	/* lfd is in the epoll set */
+  int		 type;		/* for new games that don't say */
+  struct client **client;	/* by fd */
+  int		 nclient;
+  struct table	*table;
+  int		 ntable;
+  int		 dead;		/* fd of the first client to close, or -1 */
+};
+
+static volatile sig_atomic_t done;
+
+static void	 finish(int);
+static void	 setwaiting(struct server *, const int, struct client *,
+			    const int);
+static void	 setlistening(struct server *, const int);
+static void	 flush(struct server *, const int);
+static void	 drop(struct server *, const int);
+static void	 sendline(struct server *, const int, const char *);
+static void	 tell(struct server *, const int, const char *, ...);
+static void	 tellall(struct server *, const int, const char *, ...);
+static int	 newtable(struct server *, const int);
+static void	 sit(struct server *, const int, const int, const int);
+static void	 watch(struct server *, const int, const int);
+static void	 leave(struct server *, const int);
+static void	 play(struct server *, const int, char *);
+static int	 command(struct server *, const int, char *);
+static void	 readclient(struct server *, const int);
+static void	 acceptall(struct server *);
+static void	 reap(struct server *);
+
+static void
+finish(int sig)
+{
+  (void)sig;
+  done = 1;
+}
+
+/*
+ * Ask epoll whether fd is writable, or stop asking
+ */
+static void
+setwaiting(struct server *sv, const int fd, struct client *c,
+	   const int waiting)
+{
+  struct epoll_event ev;
+
+  if (c->waiting == waiting) {
+    return;
+  }
+  ev.events = EPOLLIN | (waiting ? EPOLLOUT : 0);
+  ev.data.fd = fd;
+  if (epoll_ctl(sv->epfd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+    drop(sv, fd);
+    return;
+  }
+  c->waiting = waiting;
+}
+
+/*
+ * Ask epoll about new connections, or stop asking. Out of descriptors,
+ * we couldn't take them on, and being told of them over and over
+ * would keep us busy doing nothing.
+ */
+static void
+setlistening(struct server *sv, const int listening)
+{
+  struct epoll_event ev;
+
+  if (sv->listening == listening) {
+    return;
+  }
+  ev.events = EPOLLIN;
+  ev.data.fd = sv->lfd;
+  if (epoll_ctl(sv->epfd, listening ? EPOLL_CTL_ADD : EPOLL_CTL_DEL,
+		sv->lfd, &ev) == 0) {
+    sv->listening = listening;
+  }
+}
+
+/*
+ * Write out as much of what's queued for fd as the socket will take
+ */
+static void
+flush(struct server *sv, const int fd)
+{
+  struct client *c = sv->client[fd];
+  ssize_t n;
+
+  while (c->outlen) {
+    if ((n = send(fd, c->out, c->outlen, MSG_NOSIGNAL)) == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	break;
+      } else if (errno != EINTR) {
+	drop(sv, fd);
+	return;
+      }
+      continue;
+    }
+    memmove(c->out, c->out + n, c->outlen - n);
+    c->outlen -= n;
+  }
+  setwaiting(sv, fd, c, c->outlen > 0);
+}
+
+/*
+ * Be done with fd: it leaves its game now, and is closed once the
+ * events in hand have been seen to, so that its number isn't reused
+ * under them.
+ */
+static void
+drop(struct server *sv, const int fd)
+{
+  struct client *c = sv->client[fd];
+
+  if (c->dead) {
+    return;
+  }
+  c->dead = 1;
+  leave(sv, fd);
+  c->nextdead = sv->dead;
+  sv->dead = fd;
+}
+
+/*
+ * Queue line for fd and send it, dropping fd if it isn't keeping up
+ */
+static void
+sendline(struct server *sv, const int fd, const char *line)
+{
+  struct client *c = sv->client[fd];
+  size_t len = strlen(line);
+
+  if (c->dead) {
+    return;
+  } else if (c->outlen + len + 1 > OUTLEN) {
+    drop(sv, fd);
+    return;
+  }
+  memcpy(c->out + c->outlen, line, len);
+  c->out[c->outlen + len] = '\n';
+  c->outlen += len + 1;
+  if (!c->waiting) {
+    flush(sv, fd);
+  }
+}
+
+static void
+tell(struct server *sv, const int fd, const char *fmt, ...)
+{
+  char line[OUTLEN];
+  va_list ap;
+
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  sendline(sv, fd, line);
+}
+
+/*
+ * Tell everyone at table t, players and watchers
+ */
+static void
+tellall(struct server *sv, const int t, const char *fmt, ...)
+{
+  struct table *tb = &sv->table[t];
+  char line[OUTLEN];
+  va_list ap;
+  int c, fd;
+
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  for (c = WHITE; c <= BLACK; c++) {
+    if (tb->seat[c] != -1) {
+      sendline(sv, tb->seat[c], line);
+    }
+  }
+  for (fd = tb->watchers; fd != -1; fd = sv->client[fd]->next) {
+    sendline(sv, fd, line);
+  }
+}
+
+/*
+ * Set up a game of type at a table nobody is using. Returns its
+ * number, or -1 if there's no memory for it.
+ */
+static int
+newtable(struct server *sv, const int type)
+{
+  struct table *tb;
+  int t, n;
+
+  for (t = 0; t < sv->ntable && sv->table[t].inuse; t++) {
+    continue;
+  }
+  if (t == sv->ntable) {
+    n = sv->ntable ? 2 * sv->ntable : 64;
+    if (!(tb = realloc(sv->table, n * sizeof(*tb)))) {
+      return -1;
+    }
+    sv->table = tb;
+    for (; sv->ntable < n; sv->ntable++) {
+      sv->table[sv->ntable].inuse = 0;
+    }
+  }
+  tb = &sv->table[t];
+  initgame(&tb->g, type);
+  tb->seat[WHITE] = tb->seat[BLACK] = tb->watchers = -1;
+  tb->started = 0;
+  tb->inuse = 1;
+  return t;
+}
+
+/*
+ * Sit fd down at table t as colour, starting the game once both
+ * players are there
+ */
+static void
+sit(struct server *sv, const int fd, const int t, const int colour)
+{
+  struct table *tb = &sv->table[t];
+  struct client *c = sv->client[fd];
+  char buf[POSLEN];
+
+  tb->seat[colour] = fd;
+  c->table = t;
+  c->seat = colour;
+  tell(sv, fd, "game %d %s", t, colour == WHITE ? "white" : "black");
+  if (tb->seat[colour ^ BLACK] != -1 && !tb->started) {
+    tb->started = 1;
+    tellall(sv, t, "start %d %s", t, fmtpos(&tb->g, buf));
+  }
+}
+
+/*
+ * Have fd watch table t
+ */
+static void
+watch(struct server *sv, const int fd, const int t)
+{
+  struct table *tb = &sv->table[t];
+  struct client *c = sv->client[fd];
+  char buf[POSLEN];
+
+  c->table = t;
+  c->seat = WATCHING;
+  c->prev = -1;
+  if ((c->next = tb->watchers) != -1) {
+    sv->client[c->next]->prev = fd;
+  }
+  tb->watchers = fd;
+  tell(sv, fd, "observing %d %s", t, fmtpos(&tb->g, buf));
+}
+
+/*
+ * Take fd away from its table, if it's at one. The table is freed once
+ * the last client has gone.
+ */
+static void
+leave(struct server *sv, const int fd)
+{
+  struct client *c = sv->client[fd];
+  struct table *tb;
+
+  if (c->table == -1) {
+    return;
+  }
+  tb = &sv->table[c->table];
+  if (c->seat == WATCHING) {
+    if (c->prev != -1) {
+      sv->client[c->prev]->next = c->next;
+    } else {
+      tb->watchers = c->next;
+    }
+    if (c->next != -1) {
+      sv->client[c->next]->prev = c->prev;
+    }
+  } else {
+    tb->seat[c->seat] = -1;
+    tellall(sv, c->table, "left %d %s", c->table,
+	    c->seat == WHITE ? "white" : "black");
+  }
+  if (tb->seat[WHITE] == -1 && tb->seat[BLACK] == -1 &&
+      tb->watchers == -1) {
+    tb->inuse = 0;
+  }
+  c->table = -1;
+}
+
+/*
+ * Play the moves in the words of line for fd. Either they're all
+ * legal and played, each told to the table, or none is.
+ */
+static void
+play(struct server *sv, const int fd, char *line)
+{
+  struct client *c = sv->client[fd];
+  struct table *tb;
+  char moves[2 * INLEN], buf[MOVELEN], *w, *end;
+  game g;
+  move_t m;
+  int won;
+
+  if (c->table == -1 || c->seat == WATCHING) {
+    tell(sv, fd, "error not playing");
+    return;
+  }
+  tb = &sv->table[c->table];
+  if (!tb->started) {
+    tell(sv, fd, "error waiting for an opponent");
+    return;
+  }
+  /* Check them all first, keeping them as they're to be told; each
+     can grow by an x */
+  g = tb->g;
+  end = moves;
+  for (w = strtok(line, SEPS); w; w = strtok(NULL, SEPS)) {
+    if (winner(&g) != NOCOLOUR) {
+      tell(sv, fd, "error the game is over");
+      return;
+    } else if (g.state != c->seat) {
+      tell(sv, fd, "error not your turn");
+      return;
+    } else if (parsemove(&g, w, &m) != (int)strlen(w)) {
+      tell(sv, fd, "error illegal move %s", w);
+      return;
+    }
+    end += sprintf(end, "%s ", fmtmove(&g, m, buf));
+    makemove(&g, m);
+  }
+  if (end == moves) {
+    tell(sv, fd, "error move needs a move");
+    return;
+  }
+  tb->g = g;
+  for (w = strtok(moves, SEPS); w; w = strtok(NULL, SEPS)) {
+    tellall(sv, c->table, "moved %d %s", c->table, w);
+  }
+  if ((won = winner(&g)) != NOCOLOUR) {
+    tellall(sv, c->table, "over %d %s", c->table, resultstr(won));
+  }
+}
+
+/*
+ * Carry out one line from fd. Returns 0, or -1 once told to quit.
+ */
+static int
+command(struct server *sv, const int fd, char *line)
+{
+  struct client *c = sv->client[fd];
+  char buf[POSLEN], *cmd, *arg, *args, *end = line + strlen(line);
+  long t;
+  int i;
+
+  if (!(cmd = strtok(line, SEPS))) {
+    return 0;
+  }
+  if ((args = cmd + strlen(cmd)) < end) {
+    args++;
+  }
+  if (strcmp(cmd, "quit") == 0) {
+    return -1;
+  } else if (strcmp(cmd, "move") == 0) {
+    play(sv, fd, args);
+  } else if (strcmp(cmd, "show") == 0) {
+    if (c->table == -1) {
+      tell(sv, fd, "error not at a game");
+    } else {
+      tell(sv, fd, "position %d %s", c->table,
+	   fmtpos(&sv->table[c->table].g, buf));
+    }
+  } else if (strcmp(cmd, "leave") == 0) {
+    leave(sv, fd);
+  } else if (c->table != -1) {
+    /* The rest are for going to a game */
+    tell(sv, fd, "error already at game %d", c->table);
+  } else if (strcmp(cmd, "new") == 0) {
+    i = sv->type;
+    if ((arg = strtok(NULL, SEPS))) {
+      for (i = 0; i < NVARIANTS && strcmp(arg, topo[i].name) != 0; i++) {
+	continue;
+      }
+    }
+    if (i == NVARIANTS) {
+      tell(sv, fd, "error unknown variant");
+    } else if ((t = newtable(sv, i)) == -1) {
+      tell(sv, fd, "error no room for another game");
+    } else {
+      sit(sv, fd, t, BLACK);
+    }
+  } else if (strcmp(cmd, "join") == 0 || strcmp(cmd, "observe") == 0) {
+    arg = strtok(NULL, SEPS);
+    if (!arg || (t = strtol(arg, &end, 10)) < 0 || *end ||
+	t >= sv->ntable || !sv->table[t].inuse) {
+      tell(sv, fd, "error no such game");
+    } else if (cmd[0] == 'o') {
+      watch(sv, fd, t);
+    } else if (sv->table[t].seat[BLACK] == -1) {
+      sit(sv, fd, t, BLACK);
+    } else if (sv->table[t].seat[WHITE] == -1) {
+      sit(sv, fd, t, WHITE);
+    } else {
+      tell(sv, fd, "error game %ld is full", t);
+    }
+  } else {
+    tell(sv, fd, "error unknown command %s", cmd);
+  }
+  return 0;
+}
+
+/*
+ * Read what fd has sent and carry out each whole line of it
+ */
+static void
+readclient(struct server *sv, const int fd)
+{
+  struct client *c = sv->client[fd];
+  char *nl, *line;
+  ssize_t n;
+
+  if (c->dead) {
+    /* Dropped while flushing: what it sent goes unread */
+    return;
+  }
+  for (;;) {
+    n = recv(fd, c->in + c->inlen, INLEN - c->inlen, 0);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    } else if (n <= 0) {
+      drop(sv, fd);
+      return;
+    }
+    c->inlen += n;
+    line = c->in;
+    while ((nl = memchr(line, '\n', c->in + c->inlen - line))) {
+      *nl = '\0';
+      if (command(sv, fd, line) == -1) {
+	drop(sv, fd);
+      }
+      if (c->dead) {
+	return;
+      }
+      line = nl + 1;
+    }
+    c->inlen -= line - c->in;
+    memmove(c->in, line, c->inlen);
+    if (c->inlen == INLEN) {
+      tell(sv, fd, "error line too long");
+      drop(sv, fd);
+      return;
+    }
+  }
+}
+
+/*
+ * Take on everyone waiting to connect
+ */
+static void
+acceptall(struct server *sv)
+{
+  struct client **cl, *c;
+  struct epoll_event ev;
+  int fd, n;
+
+  while ((fd = accept(sv->lfd, NULL, NULL)) != -1 || errno == EINTR) {
+    if (fd == -1) {
+      continue;
+    }
+    if (fd >= sv->nclient) {
+      for (n = sv->nclient ? sv->nclient : 64; n <= fd; n *= 2) {
+	continue;
+      }
+      if (!(cl = realloc(sv->client, n * sizeof(*cl)))) {
+	close(fd);
+	continue;
+      }
+      sv->client = cl;
+      memset(cl + sv->nclient, 0, (n - sv->nclient) * sizeof(*cl));
+      sv->nclient = n;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 ||
+	!(c = malloc(sizeof(*c)))) {
+      close(fd);
+      continue;
+    } else if (epoll_ctl(sv->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->table = c->next = c->prev = c->nextdead = -1;
+    c->dead = c->waiting = 0;
+    c->inlen = c->outlen = 0;
+    sv->client[fd] = c;
+  }
+  if (errno == EMFILE || errno == ENFILE) {
+    /* Leave them waiting until a client goes, or for a while */
+    setlistening(sv, 0);
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK &&
+	     errno != ECONNABORTED) {
+    err(1, "Unable to accept connections");
+  }
+}
+
+/*
+ * Close the clients that have been dropped
+ */
+static void
+reap(struct server *sv)
+{
+  int fd;
+
+  while ((fd = sv->dead) != -1) {
+    sv->dead = sv->client[fd]->nextdead;
+    /* Closing takes it out of the epoll set */
+    close(fd);
+    free(sv->client[fd]);
+    sv->client[fd] = NULL;
+    setlistening(sv, 1);
+  }
+}
+
+/*
+ * Serve games, of type unless asked for others, on a Unix domain
+ * socket at path until interrupted
+ */
+void
+runserver(const char *path, const int type)
+{
+  struct server sv;
+  struct sockaddr_un sun;
+  struct epoll_event ev[MAXEVENTS];
+  struct sigaction sa;
+  struct rlimit rl;
+  struct stat st;
+  int i, n, fd;
+
+  if (strlen(path) >= sizeof(sun.sun_path)) {
+    errx(ENAMETOOLONG, "%s is too long for a socket", path);
+  }
+  /* A socket left by a server that's gone would be in the way */
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  strcpy(sun.sun_path, path);
+  if ((sv.lfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+      bind(sv.lfd, (struct sockaddr *)&sun, sizeof(sun)) == -1 ||
+      listen(sv.lfd, SOMAXCONN) == -1 ||
+      fcntl(sv.lfd, F_SETFL, fcntl(sv.lfd, F_GETFL) | O_NONBLOCK) == -1) {
+    err(errno, "Unable to listen on %s", path);
+  }
+  /* Every client is a descriptor, so allow as many as we may */
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  if ((sv.epfd = epoll_create1(0)) == -1) {
+    err(errno, "Unable to make an epoll instance");
+  }
+  ev[0].events = EPOLLIN;
+  ev[0].data.fd = sv.lfd;
+  if (epoll_ctl(sv.epfd, EPOLL_CTL_ADD, sv.lfd, &ev[0]) == -1) {
+    err(errno, "Unable to wait on %s", path);
+  }
+  sv.listening = 1;
+  sv.type = type;
+  sv.client = NULL;
+  sv.nclient = 0;
+  sv.table = NULL;
+  sv.ntable = 0;
+  sv.dead = -1;
+  /* Stop cleanly, so that the socket is removed */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = finish;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  while (!done) {
+    n = epoll_wait(sv.epfd, ev, MAXEVENTS, sv.listening ? -1 : RETRYMS);
+    if (n == -1) {
+      if (errno == EINTR) {
+	continue;
+      }
+      err(errno, "Unable to wait for clients");
+    } else if (n == 0) {
+      setlistening(&sv, 1);
+    }
+    for (i = 0; i < n; i++) {
+      fd = ev[i].data.fd;
+      if (fd == sv.lfd) {
+	acceptall(&sv);
+	continue;
+      } else if (sv.client[fd]->dead) {
+	continue;
+      }
+      if (ev[i].events & EPOLLOUT) {
+	flush(&sv, fd);
+	if (sv.client[fd]->dead) {
+	  continue;
+	}
+      }
+      if (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+	readclient(&sv, fd);
+      }
+    }
+    reap(&sv);
+  }
+  for (fd = 0; fd < sv.nclient; fd++) {
+    if (sv.client[fd]) {
+      close(fd);
+      free(sv.client[fd]);
+    }
+  }
+  close(sv.epfd);
+  close(sv.lfd);
+  unlink(path);
+  free(sv.client);
+  free(sv.table);
+}
+
+#else
+
+/*
+ * The event loop is written for epoll
+ */
+void
+runserver(const char *path, const int type)
+{
+  (void)path;
+  (void)type;
+  errx(EOPNOTSUPP, "The server needs epoll, which this system lacks");
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Board symmetries. Positions that are rotations or reflections of
+ * each other, or on the bigger boards have their inner and outer
+ * rings swapped, play out the same, so tables keyed by position need
+ * only hold one of them: the canonical one.
+ */
+
+#include "nmm.h"
+
+/*
+ * Apply symmetry s to g, giving c
+ */
+void
+symgame(const game *g, const int s, game *c)
+{
+  const struct topology *t = TOPO(g);
+
+  *c = *g;
+  c->bb[WHITE] = SYMBB(t, s, g->bb[WHITE]);
+  c->bb[BLACK] = SYMBB(t, s, g->bb[BLACK]);
+  c->key = hashgame(c);
+}
+
+/*
+ * Where symmetry s takes m
+ */
+move_t
+symmove(const game *g, const int s, const move_t m)
+{
+  const struct topology *t = TOPO(g);
+
+  if (m == NOMOVE) {
+    return m;
+  }
+  return MOVE(MOVEKIND(m), MOVEKIND(m) == SLIDE || MOVEKIND(m) == JUMP ?
+	      t->sym[s][MOVEFROM(m)] : 0, t->sym[s][MOVETO(m)]);
+}
+
+/*
+ * Which symmetry takes g to its canonical form: the one whose White
+ * pieces, and then Black pieces, make the smallest bitboard. Anything
+ * symmetric to g gives the same canonical form.
+ */
+int
+canonsym(const game *g)
+{
+  const struct topology *t = TOPO(g);
+  uint64_t v, best = UINT64_MAX;
+  int s, bests = 0;
+
+  for (s = 0; s < t->nsyms; s++) {
+    v = (uint64_t)SYMBB(t, s, g->bb[WHITE]) << 32 |
+      SYMBB(t, s, g->bb[BLACK]);
+    if (v < best) {
+      best = v;
+      bests = s;
+    }
+  }
+  return bests;
+}
+
+/*
+ * Set c to the canonical form of g. Returns the symmetry used, whose
+ * inverse, t->syminv[s], takes moves in c back to moves in g.
+ */
+int
+canonical(const game *g, game *c)
+{
+  int s = canonsym(g);
+
+  symgame(g, s, c);
+  return s;
+}
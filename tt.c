@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmm.h"
+
+/*
+ * Allocate a table of at most mb megabytes, rounded down to a power of
+ * two buckets. Returns 0 on success, -1 if out of memory.
+ */
+int
+ttinit(struct tt *tt, const size_t mb)
+{
+  size_t n = 1;
+
+  while (2 * n * sizeof(struct ttbucket) <= mb << 20) {
+    n *= 2;
+  }
+  if (!(tt->b = calloc(n, sizeof(struct ttbucket)))) {
+    return -1;
+  }
+  tt->mask = n - 1;
+  tt->age = 0;
+  return 0;
+}
+
+void
+ttfree(struct tt *tt)
+{
+  free(tt->b);
+  tt->b = NULL;
+}
+
+/*
+ * Forget everything, e.g. before a new game
+ */
+void
+ttclear(struct tt *tt)
+{
+  memset(tt->b, 0, (tt->mask + 1) * sizeof(struct ttbucket));
+  tt->age = 0;
+}
+
+/*
+ * Mark what's in the table as left over from earlier searches, so it
+ * gets replaced first
+ */
+void
+ttnewsearch(struct tt *tt)
+{
+  tt->age++;
+}
+
+/*
+ * Entries are packed into a word as move, score, depth, bound and age,
+ * from the low bits up. Only the low six bits of the age are kept.
+ */
+static uint64_t
+pack(const move_t move, const int score, const int depth, const int bound,
+     const int age)
+{
+  return (uint64_t)move | (uint64_t)(uint16_t)score << 16 |
+    (uint64_t)(depth & 0xff) << 32 | (uint64_t)(bound & 0x3) << 40 |
+    (uint64_t)(age & 0x3f) << 42;
+}
+
+static void
+unpack(const uint64_t data, struct ttentry *e)
+{
+  e->move = data & 0xffff;
+  e->score = (int16_t)(data >> 16 & 0xffff);
+  e->depth = data >> 32 & 0xff;
+  e->bound = data >> 40 & 0x3;
+  e->age = data >> 42 & 0x3f;
+}
+
+/*
+ * Look up key, copying its entry to e. Returns non-zero if found.
+ */
+int
+ttprobe(const struct tt *tt, const uint64_t key, struct ttentry *e)
+{
+  const struct ttbucket *b = &tt->b[key & tt->mask];
+  uint64_t check, data;
+  int i;
+
+  for (i = 0; i < BUCKETSIZE; i++) {
+    /* Read each word once: another thread may be rewriting the slot */
+    data = b->e[i].data;
+    check = b->e[i].check;
+    if ((check ^ data) == key) {
+      unpack(data, e);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Record what a search of depth plies found out about key. Keep the
+ * old best move if we didn't find one this time.
+ */
+void
+ttstore(struct tt *tt, const uint64_t key, const int depth, const int bound,
+	const int score, const move_t move)
+{
+  struct ttbucket *b = &tt->b[key & tt->mask];
+  struct ttslot *victim = NULL;
+  struct ttentry e, v;
+  uint64_t data;
+  int i, age = tt->age & 0x3f, same = 0;
+
+  for (i = 0; i < BUCKETSIZE; i++) {
+    data = b->e[i].data;
+    unpack(data, &e);
+    if ((b->e[i].check ^ data) == key) {
+      victim = &b->e[i];
+      v = e;
+      same = 1;
+      break;
+    }
+    /* Replace stale entries first, then the shallowest */
+    if (!victim ||
+	(e.age != age) > (v.age != age) ||
+	((e.age != age) == (v.age != age) && e.depth < v.depth)) {
+      victim = &b->e[i];
+      v = e;
+    }
+  }
+  data = pack(same && move == NOMOVE ? v.move : move, score, depth, bound,
+	      age);
+  victim->data = data;
+  victim->check = key ^ data;
+}
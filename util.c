@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 Ryan Kavanagh <rak@debian.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "nmm.h"
+
+/*
+ * Seconds since some fixed point in the past, for timing
+ */
+double
+walltime(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * How many threads to run by default
+ */
+int
+ncpus(void)
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return n < 1 ? 1 : (int)n;
+}
+
+/*
+ * Little-endian integers in files
+ */
+void
+put16(uint8_t *b, const uint16_t v)
+{
+  b[0] = v;
+  b[1] = v >> 8;
+}
+
+void
+put32(uint8_t *b, const uint32_t v)
+{
+  put16(b, v & 0xffff);
+  put16(b + 2, v >> 16);
+}
+
+void
+put64(uint8_t *b, const uint64_t v)
+{
+  put32(b, v & 0xffffffff);
+  put32(b + 4, v >> 32);
+}
+
+uint16_t
+get16(const uint8_t *b)
+{
+  return b[0] | b[1] << 8;
+}
+
+uint32_t
+get32(const uint8_t *b)
+{
+  return get16(b) | (uint32_t)get16(b + 2) << 16;
+}
+
+uint64_t
+get64(const uint8_t *b)
+{
+  return get32(b) | (uint64_t)get32(b + 4) << 32;
+}